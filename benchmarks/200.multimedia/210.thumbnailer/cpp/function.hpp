@@ -5,12 +5,29 @@
 
 #include <turbojpeg.h>
 
-void thumbnailer(const std::vector<char>& jpeg_data, int64_t width, int64_t height, cv::Mat &out)
+#include <csetjmp>
+#include <cstdio>
+// jpeglib.h needs FILE from <cstdio>.
+#include <jpeglib.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "utils.hpp"
+
+void thumbnailer(std::string_view jpeg_data, int64_t width, int64_t height, cv::Mat &out)
 {
   try
   {
     // auto t1 = std::chrono::high_resolution_clock::now();
-    cv::Mat in = cv::imdecode(jpeg_data, cv::IMREAD_COLOR);
+    cv::Mat encoded(1, static_cast<int>(jpeg_data.size()), CV_8UC1, const_cast<char*>(jpeg_data.data()));
+    cv::Mat in = cv::imdecode(encoded, cv::IMREAD_COLOR);
     // auto t2 = std::chrono::high_resolution_clock::now();
 
     //std::cout
@@ -38,58 +55,383 @@ void thumbnailer(const std::vector<char>& jpeg_data, int64_t width, int64_t heig
   }
 }
 
-void thumbnailer_fast(const std::vector<char>& jpeg_data, int target_width, int target_height, cv::Mat &out) 
-{
-  static tjhandle tj_handle = tjInitDecompress();
+/**
+ * TurboJPEG handles and working buffers of one thumbnailing thread.
+ * Contexts are pooled, so buffers keep their capacity across warm invocations
+ * even when batch workers are new threads.
+ */
+struct TurboContext {
+  tjhandle decompressor = tjInitDecompress();
+  tjhandle compressor = tjInitCompress();
+  std::vector<unsigned char> decoded;
+  std::vector<unsigned char> resized;
+  std::vector<unsigned char> strip;
+  std::vector<uint16_t> row;
+  std::vector<uint32_t> accumulator;
 
-  int orig_width, orig_height, subsamp, colorspace;
-  tjDecompressHeader3(
-    tj_handle, reinterpret_cast<const unsigned char *>(jpeg_data.data()),
-    jpeg_data.size(), &orig_width, &orig_height, &subsamp, &colorspace
-  );
+  TurboContext() = default;
+  TurboContext(const TurboContext&) = delete;
+  TurboContext& operator=(const TurboContext&) = delete;
+  ~TurboContext()
+  {
+    tjDestroy(decompressor);
+    tjDestroy(compressor);
+  }
+};
 
-  // Calculate scaling factor (1, 2, 4, or 8)
-  // Find the largest possible factor that works for our message
-  int scale_num = 1, scale_denom = 1;
-  for (int denom : {8, 4, 2, 1}) {
-    if (orig_width / denom >= target_width &&
-        orig_height / denom >= target_height) {
-      scale_denom = denom;
-      break;
+class TurboContextPool {
+public:
+  using Lease = std::unique_ptr<TurboContext, std::function<void(TurboContext*)>>;
+
+  static Lease acquire()
+  {
+    static TurboContextPool pool;
+    std::unique_ptr<TurboContext> ctx;
+    {
+      std::lock_guard<std::mutex> lock(pool._mutex);
+      if (!pool._free.empty()) {
+        ctx = std::move(pool._free.back());
+        pool._free.pop_back();
+      }
     }
+    if (!ctx)
+      ctx = std::make_unique<TurboContext>();
+    return Lease(ctx.release(), [](TurboContext* released) {
+      std::lock_guard<std::mutex> lock(pool._mutex);
+      pool._free.emplace_back(released);
+    });
   }
 
-  // libjpeg-turbo supports these exact fractional scales during decode
-  tjscalingfactor sf = {scale_num, scale_denom};
-  int scaled_width = TJSCALED(orig_width, sf);
-  int scaled_height = TJSCALED(orig_height, sf);
+private:
+  std::mutex _mutex;
+  std::vector<std::unique_ptr<TurboContext>> _free;
+};
 
-  std::vector<unsigned char> buffer(scaled_width * scaled_height * 3);
+struct JpegOptions {
+  int quality = 95;
+  int subsampling = TJSAMP_420;
+};
 
-  //auto t1 = std::chrono::high_resolution_clock::now();
+/**
+ * Box weights of an area resampling along one axis, in 8-bit fixed point.
+ * Destination pixel i covers source pixels [begin[i], begin[i] + count[i]),
+ * and its weights always sum to exactly 256.
+ */
+struct AreaWeights {
+  std::vector<int> begin;
+  std::vector<int> count;
+  std::vector<uint16_t> weights;
+  std::vector<int> offset;
 
-  tjDecompress2(
-    tj_handle, reinterpret_cast<const unsigned char *>(jpeg_data.data()),
-    jpeg_data.size(), buffer.data(), scaled_width, 0, scaled_height,
-    TJPF_BGR, TJFLAG_FASTDCT | TJFLAG_FASTUPSAMPLE
-  );
+  AreaWeights(int src_size, int dst_size)
+    : begin(dst_size), count(dst_size), offset(dst_size)
+  {
+    double scale = static_cast<double>(src_size) / dst_size;
+    for (int i = 0; i < dst_size; ++i) {
+      double from = i * scale, to = std::min((i + 1) * scale, static_cast<double>(src_size));
+      int first = static_cast<int>(from);
+      int last = std::min(static_cast<int>(std::ceil(to)), src_size);
+      begin[i] = first;
+      count[i] = std::max(last - first, 1);
+      offset[i] = static_cast<int>(weights.size());
+
+      // Quantize the cumulative coverage, so that rounding errors do not accumulate.
+      int previous = 0;
+      for (int j = 0; j < count[i]; ++j) {
+        double covered = std::min(to, static_cast<double>(first + j + 1)) - from;
+        int cumulative = j + 1 == count[i] ? 256 : static_cast<int>(covered / (to - from) * 256 + 0.5);
+        weights.push_back(static_cast<uint16_t>(cumulative - previous));
+        previous = cumulative;
+      }
+    }
+  }
+};
+
+/**
+ * Area-averaging resize of a packed 3-channel image, consuming source rows
+ * one at a time. Each source row is filtered horizontally once and added to
+ * the accumulators of the destination rows it covers; a destination row is
+ * written out as soon as its last source row arrives. The vertical pass is a
+ * multiply-add over contiguous 16-bit rows into 32-bit accumulators, which
+ * the compiler vectorizes.
+ */
+class AreaResizer {
+public:
+  AreaResizer(
+    int src_width, int src_height, int dst_width, int dst_height,
+    unsigned char* dst, TurboContext& ctx
+  ) : _horizontal(src_width, dst_width), _vertical(src_height, dst_height),
+      _dst_height(dst_height), _row_size(static_cast<size_t>(dst_width) * 3), _dst(dst),
+      // Upper bound on destination rows that are accumulated at the same time.
+      _open_rows(dst_height / src_height + 2)
+  {
+    ctx.row.resize(_row_size);
+    ctx.accumulator.resize(_row_size * _open_rows);
+    _row = ctx.row.data();
+    _accumulator = ctx.accumulator.data();
+  }
+
+  void push(const unsigned char* src_row)
+  {
+    int y = _src_row++;
+    int dst_width = static_cast<int>(_row_size / 3);
+    uint16_t* __restrict row = _row;
+
+    for (int x = 0; x < dst_width; ++x) {
+      const unsigned char* px = src_row + static_cast<size_t>(_horizontal.begin[x]) * 3;
+      const uint16_t* w = _horizontal.weights.data() + _horizontal.offset[x];
+      uint32_t b = 0, g = 0, r = 0;
+      for (int j = 0; j < _horizontal.count[x]; ++j, px += 3) {
+        b += w[j] * px[0];
+        g += w[j] * px[1];
+        r += w[j] * px[2];
+      }
+      row[x * 3] = static_cast<uint16_t>(b);
+      row[x * 3 + 1] = static_cast<uint16_t>(g);
+      row[x * 3 + 2] = static_cast<uint16_t>(r);
+    }
+
+    for (int d = _next_dst; d < _dst_height && _vertical.begin[d] <= y; ++d) {
+      uint32_t* __restrict acc = _accumulator + (d % _open_rows) * _row_size;
+      if (y == _vertical.begin[d])
+        std::fill(acc, acc + _row_size, 0u);
 
-  //auto t2 = std::chrono::high_resolution_clock::now();
-  //std::cout
-  //    << "Fast decode to " << scaled_width << "x" << scaled_height << ": "
-  //    << std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count()
-  //    << "ms\n";
+      uint32_t weight = _vertical.weights[_vertical.offset[d] + y - _vertical.begin[d]];
+      for (size_t i = 0; i < _row_size; ++i)
+        acc[i] += weight * row[i];
 
+      // Rows end in order, so only the first open row can be complete.
+      if (y == _vertical.begin[d] + _vertical.count[d] - 1) {
+        unsigned char* dst_row = _dst + static_cast<size_t>(d) * _row_size;
+        for (size_t i = 0; i < _row_size; ++i)
+          dst_row[i] = static_cast<unsigned char>((acc[i] + (1u << 15)) >> 16);
+        _next_dst = d + 1;
+      }
+    }
+  }
+
+private:
+  AreaWeights _horizontal;
+  AreaWeights _vertical;
+  int _dst_height;
+  size_t _row_size;
+  unsigned char* _dst;
+  size_t _open_rows;
+  uint16_t* _row;
+  uint32_t* _accumulator;
+  int _src_row = 0;
+  int _next_dst = 0;
+};
+
+void area_resize(
+  const unsigned char* src, int src_width, int src_height,
+  unsigned char* dst, int dst_width, int dst_height, TurboContext& ctx
+)
+{
+  AreaResizer resizer(src_width, src_height, dst_width, dst_height, dst, ctx);
+  for (int y = 0; y < src_height; ++y)
+    resizer.push(src + static_cast<size_t>(y) * src_width * 3);
+}
+
+enum class DecodeMode { AUTO, FULL, STRIPS };
+
+// In AUTO mode, images whose scaled decode would exceed this size are decoded in strips.
+constexpr size_t STRIP_DECODE_THRESHOLD = 16 * 1024 * 1024;
+constexpr int STRIP_ROWS = 16;
+
+// Picks the largest DCT scaling denominator (8, 4, 2 or 1) that keeps the image above the target.
+int dct_scale_denom(int orig_width, int orig_height, int target_width, int target_height)
+{
+  for (int denom : {8, 4, 2, 1}) {
+    if (orig_width / denom >= target_width &&
+        orig_height / denom >= target_height)
+      return denom;
+  }
+  return 1;
+}
+
+// Thumbnail size that fits into the target while maintaining the aspect ratio.
+void thumbnail_size(int orig_width, int orig_height, int& target_width, int& target_height)
+{
   double scale_w = static_cast<double>(target_width) / orig_width;
   double scale_h = static_cast<double>(target_height) / orig_height;
   double scale = std::min(scale_w, scale_h); // Use smaller scale to fit within bounds
 
-  target_width = static_cast<int>(orig_width * scale);
-  target_height = static_cast<int>(orig_height * scale);
+  target_width = std::max(static_cast<int>(orig_width * scale), 1);
+  target_height = std::max(static_cast<int>(orig_height * scale), 1);
+}
+
+bool jpeg_dimensions(std::string_view jpeg_data, TurboContext& ctx, int& width, int& height)
+{
+  int subsamp, colorspace;
+  if (tjDecompressHeader3(
+    ctx.decompressor, reinterpret_cast<const unsigned char *>(jpeg_data.data()),
+    jpeg_data.size(), &width, &height, &subsamp, &colorspace
+  ) != 0) {
+    std::cerr << "TurboJPEG error: " << tjGetErrorStr2(ctx.decompressor) << std::endl;
+    return false;
+  }
+  return true;
+}
+
+struct JpegErrorManager {
+  jpeg_error_mgr base;
+  std::jmp_buf jump;
+};
+
+void jpeg_error_exit(j_common_ptr cinfo)
+{
+  (*cinfo->err->output_message)(cinfo);
+  std::longjmp(reinterpret_cast<JpegErrorManager*>(cinfo->err)->jump, 1);
+}
+
+/**
+ * Bounded-memory variant of thumbnailer_fast: scanlines are decoded with the
+ * libjpeg API in strips of STRIP_ROWS and fed directly to the area resizer,
+ * so the full decoded image never exists. Peak memory is the strip, the
+ * thumbnail and the decoder state; only progressive JPEGs still need
+ * libjpeg's whole-image coefficient buffer.
+ */
+bool thumbnailer_strips(
+  std::string_view jpeg_data, int target_width, int target_height, cv::Mat &out, TurboContext& ctx
+)
+{
+  jpeg_decompress_struct cinfo;
+  JpegErrorManager error;
+  cinfo.err = jpeg_std_error(&error.base);
+  error.base.error_exit = jpeg_error_exit;
+
+  // Declared before setjmp: libjpeg errors longjmp back here, skipping destructors.
+  std::optional<AreaResizer> resizer;
+  JSAMPROW rows[STRIP_ROWS];
+
+  jpeg_create_decompress(&cinfo);
+  if (setjmp(error.jump)) {
+    resizer.reset();
+    jpeg_destroy_decompress(&cinfo);
+    return false;
+  }
+
+  jpeg_mem_src(
+    &cinfo, reinterpret_cast<const unsigned char *>(jpeg_data.data()), jpeg_data.size()
+  );
+  jpeg_read_header(&cinfo, TRUE);
+
+  int orig_width = cinfo.image_width, orig_height = cinfo.image_height;
+  cinfo.scale_num = 1;
+  cinfo.scale_denom = dct_scale_denom(orig_width, orig_height, target_width, target_height);
+  cinfo.out_color_space = JCS_EXT_BGR;
+  cinfo.dct_method = JDCT_IFAST;
+  cinfo.do_fancy_upsampling = FALSE;
+  jpeg_start_decompress(&cinfo);
+
+  int scaled_width = cinfo.output_width;
+  int scaled_height = cinfo.output_height;
+  thumbnail_size(orig_width, orig_height, target_width, target_height);
+
+  ctx.resized.resize(static_cast<size_t>(target_width) * target_height * 3);
+  resizer.emplace(scaled_width, scaled_height, target_width, target_height, ctx.resized.data(), ctx);
+
+  const size_t stride = static_cast<size_t>(scaled_width) * 3;
+  ctx.strip.resize(stride * STRIP_ROWS);
+  for (int i = 0; i < STRIP_ROWS; ++i)
+    rows[i] = ctx.strip.data() + i * stride;
+
+  while (cinfo.output_scanline < cinfo.output_height) {
+    JDIMENSION lines = jpeg_read_scanlines(&cinfo, rows, STRIP_ROWS);
+    for (JDIMENSION i = 0; i < lines; ++i)
+      resizer->push(rows[i]);
+  }
+
+  jpeg_finish_decompress(&cinfo);
+  jpeg_destroy_decompress(&cinfo);
+
+  out = cv::Mat(target_height, target_width, CV_8UC3, ctx.resized.data());
+  return true;
+}
+
+/**
+ * Decodes with DCT-domain scaling to the smallest size not below the target,
+ * then area-resizes to the thumbnail size that fits into target_width x target_height.
+ * Large images are decoded in strips unless the mode requests a full decode.
+ * `out` is a view of the context's buffers, valid until its next use.
+ */
+bool thumbnailer_fast(
+  std::string_view jpeg_data, int target_width, int target_height, cv::Mat &out, TurboContext& ctx,
+  DecodeMode mode = DecodeMode::AUTO
+)
+{
+  if (mode == DecodeMode::STRIPS)
+    return thumbnailer_strips(jpeg_data, target_width, target_height, out, ctx);
+
+  int orig_width, orig_height, subsamp, colorspace;
+  if (tjDecompressHeader3(
+    ctx.decompressor, reinterpret_cast<const unsigned char *>(jpeg_data.data()),
+    jpeg_data.size(), &orig_width, &orig_height, &subsamp, &colorspace
+  ) != 0) {
+    std::cerr << "TurboJPEG error: " << tjGetErrorStr2(ctx.decompressor) << std::endl;
+    return false;
+  }
+
+  // libjpeg-turbo supports these exact fractional scales during decode
+  tjscalingfactor sf = {1, dct_scale_denom(orig_width, orig_height, target_width, target_height)};
+  int scaled_width = TJSCALED(orig_width, sf);
+  int scaled_height = TJSCALED(orig_height, sf);
+
+  size_t decoded_size = static_cast<size_t>(scaled_width) * scaled_height * 3;
+  if (mode == DecodeMode::AUTO && decoded_size > STRIP_DECODE_THRESHOLD)
+    return thumbnailer_strips(jpeg_data, target_width, target_height, out, ctx);
+
+  ctx.decoded.resize(decoded_size);
+  {
+    sebs::trace::ScopedSpan span("decode");
+    if (tjDecompress2(
+      ctx.decompressor, reinterpret_cast<const unsigned char *>(jpeg_data.data()),
+      jpeg_data.size(), ctx.decoded.data(), scaled_width, 0, scaled_height,
+      TJPF_BGR, TJFLAG_FASTDCT | TJFLAG_FASTUPSAMPLE
+    ) != 0) {
+      std::cerr << "TurboJPEG error: " << tjGetErrorStr2(ctx.decompressor) << std::endl;
+      return false;
+    }
+  }
+
+  thumbnail_size(orig_width, orig_height, target_width, target_height);
+
+  // The decoded image may already have the thumbnail size.
+  if (scaled_width == target_width && scaled_height == target_height) {
+    out = cv::Mat(scaled_height, scaled_width, CV_8UC3, ctx.decoded.data());
+    return true;
+  }
 
-  cv::Mat temp(scaled_height, scaled_width, CV_8UC3, buffer.data());
   // Final scaling
-  if (scaled_width != target_width || scaled_height != target_height) {
-    cv::resize(temp, out, cv::Size(target_width, target_height), 0, 0, cv::INTER_LINEAR);
+  sebs::trace::ScopedSpan span("resize");
+  ctx.resized.resize(static_cast<size_t>(target_width) * target_height * 3);
+  area_resize(
+    ctx.decoded.data(), scaled_width, scaled_height,
+    ctx.resized.data(), target_width, target_height, ctx
+  );
+  out = cv::Mat(target_height, target_width, CV_8UC3, ctx.resized.data());
+  return true;
+}
+
+/**
+ * Encodes a packed BGR image with the context's TurboJPEG compressor.
+ * `out` is sized to the worst case and compressed into in place, so a buffer
+ * reused across invocations is not reallocated.
+ */
+bool encode_jpeg(const cv::Mat& image, const JpegOptions& options, TurboContext& ctx, std::vector<unsigned char>& out)
+{
+  out.resize(tjBufSize(image.cols, image.rows, options.subsampling));
+  unsigned char* data = out.data();
+  unsigned long size = out.size();
+  if (tjCompress2(
+    ctx.compressor, image.data, image.cols, static_cast<int>(image.step), image.rows,
+    TJPF_BGR, &data, &size, options.subsampling, options.quality, TJFLAG_NOREALLOC
+  ) != 0) {
+    std::cerr << "TurboJPEG error: " << tjGetErrorStr2(ctx.compressor) << std::endl;
+    out.clear();
+    return false;
   }
+  out.resize(size);
+  return true;
 }
@@ -13,8 +13,13 @@
 
 #include <turbojpeg.h>
 
+#include <algorithm>
+#include <atomic>
+#include <deque>
 #include <string>
+#include <string_view>
 #include <iostream>
+#include <thread>
 #include <vector>
 
 #include "function.hpp"
@@ -23,12 +28,442 @@
 
 bool opencv_initialized = false;
 
+static rapidjson::Document make_error(const std::string& message)
+{
+  rapidjson::Document error;
+  error.SetObject();
+  error.AddMember("error", rapidjson::Value(message.c_str(), error.GetAllocator()), error.GetAllocator());
+  return error;
+}
+
+// Create a unique key name for the output image
+static std::string output_key_name(const std::string& output_key_prefix, const std::string& image_name)
+{
+  std::string output_key = output_key_prefix + "/" + image_name;
+  std::string name, extension;
+  if (output_key.find_last_of('.') != std::string::npos) {
+    name = output_key.substr(0, output_key.find_last_of('.'));
+    extension = output_key.substr(output_key.find_last_of('.'));
+  } else {
+    name = output_key;
+    extension = "";
+  }
+  return name + "." + boost::uuids::to_string(boost::uuids::random_generator()()) + extension;
+}
+
+// Optional "quality" (1-100) and "subsampling" ("444", "422", "420" or "gray") of the thumbnail.
+static JpegOptions parse_jpeg_options(const rapidjson::Value& object)
+{
+  JpegOptions options;
+  if (object.HasMember("quality") && object["quality"].IsInt())
+    options.quality = std::min(std::max(object["quality"].GetInt(), 1), 100);
+  if (object.HasMember("subsampling") && object["subsampling"].IsString()) {
+    std::string subsampling = object["subsampling"].GetString();
+    if (subsampling == "444")
+      options.subsampling = TJSAMP_444;
+    else if (subsampling == "422")
+      options.subsampling = TJSAMP_422;
+    else if (subsampling == "gray")
+      options.subsampling = TJSAMP_GRAY;
+  }
+  return options;
+}
+
+// Optional "decode" mode: "full", "strips" or "auto" (default, strips for large images).
+static DecodeMode parse_decode_mode(const rapidjson::Value& object)
+{
+  if (object.HasMember("decode") && object["decode"].IsString()) {
+    std::string mode = object["decode"].GetString();
+    if (mode == "full")
+      return DecodeMode::FULL;
+    if (mode == "strips")
+      return DecodeMode::STRIPS;
+  }
+  return DecodeMode::AUTO;
+}
+
+struct BatchImage {
+  std::string input_key;
+  std::string output_key;
+  std::vector<unsigned char> output;
+  uint64_t download_time = 0;
+  uint64_t compute_time = 0;
+  uint64_t encode_time = 0;
+  uint64_t upload_time = 0;
+  uint64_t download_size = 0;
+  uint64_t upload_size = 0;
+  const char* error = nullptr;
+};
+
+/**
+ * Batch mode: download -> decode/resize/encode -> upload, as three stages
+ * connected by bounded queues. Network stages run on their own threads, so
+ * transfers of some images overlap with the processing of others; the CPU
+ * stage has one worker per available vCPU.
+ *
+ * Downloaded objects are held in a pool of input buffers. A download waits
+ * for a free buffer, and the CPU stage returns it after decoding, so the
+ * number of images in memory is bounded regardless of the batch size.
+ */
+static rapidjson::Document process_batch(
+  sebs::Storage& client, const rapidjson::Value& keys, const std::string& bucket_name,
+  const std::string& input_key_prefix, const std::string& output_key_prefix,
+  int width, int height, const JpegOptions& jpeg_options, DecodeMode decode_mode
+)
+{
+  rapidjson::SizeType count = keys.Size();
+  std::vector<BatchImage> images(count);
+  for (rapidjson::SizeType i = 0; i < count; ++i) {
+    if (!keys[i].IsString())
+      return make_error("Batch keys must be strings.");
+    std::string image_name = keys[i].GetString();
+    images[i].input_key = input_key_prefix + "/" + image_name;
+    images[i].output_key = output_key_name(output_key_prefix, image_name);
+  }
+
+  size_t cpu_workers = std::min(sebs::available_cpus(), std::max<size_t>(count, 1));
+  size_t io_workers = std::min(std::max<size_t>(2 * cpu_workers, 4), std::max<size_t>(count, 1));
+  size_t slots = io_workers + 2 * cpu_workers;
+
+  // Buffers are reused across warm invocations; deque keeps their addresses stable.
+  static std::deque<std::vector<char>> input_buffers;
+  while (input_buffers.size() < slots)
+    input_buffers.emplace_back();
+
+  struct Downloaded {
+    size_t idx;
+    size_t slot;
+    std::string_view body;
+  };
+  sebs::BoundedQueue<size_t> free_slots(slots);
+  sebs::BoundedQueue<Downloaded> decode_queue(slots);
+  sebs::BoundedQueue<size_t> upload_queue(io_workers);
+  for (size_t slot = 0; slot < slots; ++slot)
+    free_slots.push(slot);
+
+  std::atomic<size_t> next_download{0};
+  std::atomic<size_t> downloaders_left{io_workers};
+  std::atomic<size_t> compute_left{cpu_workers};
+
+  sebs::trace::ScopedSpan pipeline_span("pipeline");
+  int32_t parent = pipeline_span.id();
+  sebs::memory::reset_peak_rss();
+  uint64_t start_time = timeSinceEpochMicrosec();
+
+  auto download_stage = [&]() {
+    for (size_t idx = next_download.fetch_add(1); idx < count; idx = next_download.fetch_add(1)) {
+      size_t slot;
+      free_slots.pop(slot);
+
+      auto& image = images[idx];
+      std::string_view body;
+      {
+        sebs::trace::ScopedSpan span("download", parent);
+        std::tie(body, image.download_time) = client.download_file(bucket_name, image.input_key, input_buffers[slot]);
+      }
+      if (body.empty()) {
+        image.error = "Failed to download object from S3.";
+        free_slots.push(slot);
+        continue;
+      }
+      image.download_size = body.size();
+      decode_queue.push({idx, slot, body});
+    }
+    if (downloaders_left.fetch_sub(1) == 1)
+      decode_queue.close();
+  };
+
+  auto compute_stage = [&]() {
+    auto ctx = TurboContextPool::acquire();
+    Downloaded item;
+    cv::Mat out_image;
+    while (decode_queue.pop(item)) {
+      auto& image = images[item.idx];
+      bool decoded;
+      {
+        sebs::trace::ScopedSpan span("compute", parent);
+        auto begin = timeSinceEpochMicrosec();
+        decoded = thumbnailer_fast(item.body, width, height, out_image, *ctx, decode_mode);
+        image.compute_time = timeSinceEpochMicrosec() - begin;
+      }
+      free_slots.push(item.slot);
+      if (!decoded) {
+        image.error = "Failed to decode image.";
+        continue;
+      }
+
+      {
+        sebs::trace::ScopedSpan span("encode", parent);
+        auto begin = timeSinceEpochMicrosec();
+        bool encoded = encode_jpeg(out_image, jpeg_options, *ctx, image.output);
+        image.encode_time = timeSinceEpochMicrosec() - begin;
+        if (!encoded) {
+          image.error = "Failed to encode thumbnail.";
+          continue;
+        }
+      }
+      upload_queue.push(item.idx);
+    }
+    if (compute_left.fetch_sub(1) == 1)
+      upload_queue.close();
+  };
+
+  auto upload_stage = [&]() {
+    size_t idx;
+    while (upload_queue.pop(idx)) {
+      auto& image = images[idx];
+      sebs::trace::ScopedSpan span("upload", parent);
+      image.upload_size = image.output.size();
+      image.upload_time = client.upload_random_file(
+        bucket_name, image.output_key, true, reinterpret_cast<char *>(image.output.data()),
+        image.output.size()
+      );
+      if (image.upload_time == 0)
+        image.error = "Failed to upload object to S3.";
+      std::vector<unsigned char>().swap(image.output);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < io_workers; ++i)
+    threads.emplace_back(download_stage);
+  for (size_t i = 0; i < cpu_workers; ++i)
+    threads.emplace_back(compute_stage);
+  for (size_t i = 0; i < io_workers; ++i)
+    threads.emplace_back(upload_stage);
+  for (auto& thread : threads)
+    thread.join();
+
+  uint64_t total_time = timeSinceEpochMicrosec() - start_time;
+  uint64_t peak_rss = sebs::memory::peak_rss();
+
+  rapidjson::Document val;
+  val.SetObject();
+  auto& alloc = val.GetAllocator();
+
+  size_t failed = 0;
+  BatchImage sum;
+  rapidjson::Value output_keys(rapidjson::kArrayType);
+  rapidjson::Value per_image(rapidjson::kArrayType);
+  for (auto& image : images) {
+    rapidjson::Value entry(rapidjson::kObjectType);
+    entry.AddMember("key", rapidjson::Value(image.input_key.c_str(), alloc), alloc);
+    if (image.error) {
+      ++failed;
+      output_keys.PushBack(rapidjson::Value(rapidjson::kNullType), alloc);
+      entry.AddMember("error", rapidjson::StringRef(image.error), alloc);
+    } else {
+      output_keys.PushBack(rapidjson::Value(image.output_key.c_str(), alloc), alloc);
+    }
+    entry.AddMember("download_time", (int64_t)image.download_time, alloc);
+    entry.AddMember("compute_time", (int64_t)image.compute_time, alloc);
+    entry.AddMember("encode_time", (int64_t)image.encode_time, alloc);
+    entry.AddMember("upload_time", (int64_t)image.upload_time, alloc);
+    entry.AddMember("download_size", (int64_t)image.download_size, alloc);
+    entry.AddMember("upload_size", (int64_t)image.upload_size, alloc);
+    per_image.PushBack(entry, alloc);
+
+    sum.download_time += image.download_time;
+    sum.compute_time += image.compute_time;
+    sum.encode_time += image.encode_time;
+    sum.upload_time += image.upload_time;
+    sum.download_size += image.download_size;
+    sum.upload_size += image.upload_size;
+  }
+
+  if (failed == count)
+    return make_error("Failed to process any image of the batch.");
+
+  rapidjson::Value result(rapidjson::kObjectType);
+  result.AddMember("bucket", rapidjson::Value(bucket_name.c_str(), alloc), alloc);
+  result.AddMember("keys", output_keys, alloc);
+  result.AddMember("failed", (uint64_t)failed, alloc);
+  val.AddMember("result", result, alloc);
+
+  // Stage times are sums over images; total_time is the wall time of the pipeline.
+  rapidjson::Value measurements(rapidjson::kObjectType);
+  measurements.AddMember("total_time", (int64_t)total_time, alloc);
+  measurements.AddMember("download_time", (int64_t)sum.download_time, alloc);
+  measurements.AddMember("upload_time", (int64_t)sum.upload_time, alloc);
+  measurements.AddMember("compute_time", (int64_t)sum.compute_time, alloc);
+  measurements.AddMember("encode_time", (int64_t)sum.encode_time, alloc);
+  measurements.AddMember("peak_rss", (int64_t)peak_rss, alloc);
+  measurements.AddMember("download_size", (int64_t)sum.download_size, alloc);
+  measurements.AddMember("upload_size", (int64_t)sum.upload_size, alloc);
+  measurements.AddMember("images", (uint64_t)count, alloc);
+  measurements.AddMember("cpu_workers", (uint64_t)cpu_workers, alloc);
+  measurements.AddMember("io_workers", (uint64_t)io_workers, alloc);
+  measurements.AddMember("per_image", per_image, alloc);
+  val.AddMember("measurement", measurements, alloc);
+
+  return val;
+}
+
+/**
+ * Pyramid mode: one download and one decode at the DCT scale of the largest
+ * requested size. Each smaller size is area-resized from the next larger
+ * level, the levels are encoded in parallel and uploaded concurrently.
+ */
+static rapidjson::Document process_pyramid(
+  sebs::Storage& client, const rapidjson::Value& sizes, const std::string& bucket_name,
+  const std::string& input_key_prefix, const std::string& output_key_prefix,
+  const std::string& image_name, const JpegOptions& jpeg_options, DecodeMode decode_mode
+)
+{
+  struct Level {
+    int width;
+    int height;
+    size_t idx;
+    int requested_width;
+    int requested_height;
+  };
+  std::vector<Level> levels;
+  for (rapidjson::SizeType i = 0; i < sizes.Size(); ++i) {
+    const auto& size = sizes[i];
+    if (!size.IsArray() || size.Size() != 2 || !size[0].IsInt() || !size[1].IsInt() ||
+        size[0].GetInt() <= 0 || size[1].GetInt() <= 0)
+      return make_error("Sizes must be [width, height] pairs of positive integers.");
+    levels.push_back({size[0].GetInt(), size[1].GetInt(), i, size[0].GetInt(), size[1].GetInt()});
+  }
+
+  static std::vector<char> input_buffer;
+  std::string input_key = input_key_prefix + "/" + image_name;
+  auto [body, download_time] = client.download_file(bucket_name, input_key, input_buffer);
+  if (body.empty())
+    return make_error("Failed to download object from S3: " + input_key);
+
+  auto ctx = TurboContextPool::acquire();
+  int orig_width, orig_height;
+  if (!jpeg_dimensions(body, *ctx, orig_width, orig_height))
+    return make_error("Failed to decode image: " + image_name);
+  for (auto& level : levels)
+    thumbnail_size(orig_width, orig_height, level.width, level.height);
+  std::stable_sort(levels.begin(), levels.end(), [](const Level& a, const Level& b) {
+    return static_cast<int64_t>(a.width) * a.height > static_cast<int64_t>(b.width) * b.height;
+  });
+
+  // Level and output buffers keep their capacity across warm invocations.
+  static std::vector<std::vector<unsigned char>> level_buffers;
+  static std::vector<std::vector<unsigned char>> out_buffers;
+  if (level_buffers.size() < levels.size()) {
+    level_buffers.resize(levels.size());
+    out_buffers.resize(levels.size());
+  }
+
+  sebs::memory::reset_peak_rss();
+  std::vector<cv::Mat> images(levels.size());
+  uint64_t computing_time, peak_rss;
+  {
+    sebs::trace::ScopedSpan span("compute");
+    auto start_time = timeSinceEpochMicrosec();
+    auto& largest = levels[0];
+    if (!thumbnailer_fast(body, largest.requested_width, largest.requested_height, images[0], *ctx, decode_mode))
+      return make_error("Failed to decode image: " + image_name);
+    largest.width = images[0].cols;
+    largest.height = images[0].rows;
+
+    for (size_t i = 1; i < levels.size(); ++i) {
+      const cv::Mat& prev = images[i - 1];
+      if (prev.cols == levels[i].width && prev.rows == levels[i].height) {
+        images[i] = prev;
+        continue;
+      }
+      level_buffers[i].resize(static_cast<size_t>(levels[i].width) * levels[i].height * 3);
+      area_resize(
+        prev.data, prev.cols, prev.rows,
+        level_buffers[i].data(), levels[i].width, levels[i].height, *ctx
+      );
+      images[i] = cv::Mat(levels[i].height, levels[i].width, CV_8UC3, level_buffers[i].data());
+    }
+    computing_time = timeSinceEpochMicrosec() - start_time;
+    peak_rss = sebs::memory::peak_rss();
+  }
+
+  uint64_t encode_time;
+  std::vector<char> encoded(levels.size());
+  {
+    sebs::trace::ScopedSpan span("encode");
+    int32_t parent = span.id();
+    auto start_time = timeSinceEpochMicrosec();
+    sebs::parallel_for(levels.size(), sebs::available_cpus(), [&](size_t i) {
+      sebs::trace::ScopedSpan level_span("encode_level", parent);
+      auto encoder = TurboContextPool::acquire();
+      encoded[i] = encode_jpeg(images[i], jpeg_options, *encoder, out_buffers[i]);
+    });
+    encode_time = timeSinceEpochMicrosec() - start_time;
+  }
+  if (std::find(encoded.begin(), encoded.end(), false) != encoded.end())
+    return make_error("Failed to encode thumbnail: " + image_name);
+
+  std::vector<std::string> key_names(levels.size());
+  for (auto& key_name : key_names)
+    key_name = output_key_name(output_key_prefix, image_name);
+
+  uint64_t upload_time;
+  std::vector<uint64_t> upload_times(levels.size());
+  {
+    sebs::trace::ScopedSpan span("upload");
+    int32_t parent = span.id();
+    auto start_time = timeSinceEpochMicrosec();
+    sebs::parallel_for(levels.size(), levels.size(), [&](size_t i) {
+      sebs::trace::ScopedSpan level_span("upload_level", parent);
+      upload_times[i] = client.upload_random_file(
+        bucket_name, key_names[i], true, reinterpret_cast<char *>(out_buffers[i].data()),
+        out_buffers[i].size()
+      );
+    });
+    upload_time = timeSinceEpochMicrosec() - start_time;
+  }
+  for (size_t i = 0; i < levels.size(); ++i) {
+    if (upload_times[i] == 0)
+      return make_error("Failed to upload object to S3: " + key_names[i]);
+  }
+
+  rapidjson::Document val;
+  val.SetObject();
+  auto& alloc = val.GetAllocator();
+
+  // Outputs are reported in the order of the requested sizes.
+  std::vector<size_t> order(levels.size());
+  for (size_t i = 0; i < levels.size(); ++i)
+    order[levels[i].idx] = i;
+
+  uint64_t upload_size = 0;
+  rapidjson::Value keys(rapidjson::kArrayType);
+  rapidjson::Value output_sizes(rapidjson::kArrayType);
+  for (size_t i : order) {
+    keys.PushBack(rapidjson::Value(key_names[i].c_str(), alloc), alloc);
+    rapidjson::Value size(rapidjson::kArrayType);
+    size.PushBack(levels[i].width, alloc);
+    size.PushBack(levels[i].height, alloc);
+    output_sizes.PushBack(size, alloc);
+    upload_size += out_buffers[i].size();
+  }
+
+  rapidjson::Value result(rapidjson::kObjectType);
+  result.AddMember("bucket", rapidjson::Value(bucket_name.c_str(), alloc), alloc);
+  result.AddMember("keys", keys, alloc);
+  result.AddMember("sizes", output_sizes, alloc);
+  val.AddMember("result", result, alloc);
+
+  // encode_time and upload_time are wall times of the parallel stages.
+  rapidjson::Value measurements(rapidjson::kObjectType);
+  measurements.AddMember("download_time", (int64_t)download_time, alloc);
+  measurements.AddMember("upload_time", (int64_t)upload_time, alloc);
+  measurements.AddMember("compute_time", (int64_t)computing_time, alloc);
+  measurements.AddMember("encode_time", (int64_t)encode_time, alloc);
+  measurements.AddMember("peak_rss", (int64_t)peak_rss, alloc);
+  measurements.AddMember("download_size", (int64_t)body.size(), alloc);
+  measurements.AddMember("upload_size", (int64_t)upload_size, alloc);
+  measurements.AddMember("levels", (uint64_t)levels.size(), alloc);
+  val.AddMember("measurement", measurements, alloc);
+
+  return val;
+}
 
 rapidjson::Document function(const rapidjson::Value& request)
 {
-  auto process_start = timeSinceEpochMicrosec();
-  static sebs::Storage client_ = sebs::Storage::get_client();
-  auto process_end = timeSinceEpochMicrosec();
+  static sebs::Storage& client_ = sebs::Storage::get_client();
 
   if (!request.HasMember("bucket") || !request["bucket"].IsObject()) {
     rapidjson::Document error;
@@ -41,19 +476,45 @@ rapidjson::Document function(const rapidjson::Value& request)
   std::string input_key_prefix = bucket_obj["input"].GetString();
   std::string output_key_prefix = bucket_obj["output"].GetString();
 
-  std::string image_name = request["object"]["key"].GetString();
+  JpegOptions jpeg_options = parse_jpeg_options(request["object"]);
+  DecodeMode decode_mode = parse_decode_mode(request["object"]);
+
+  if (request["object"].HasMember("sizes")) {
+    const auto& sizes = request["object"]["sizes"];
+    if (!sizes.IsArray() || sizes.Empty())
+      return make_error("Sizes must be a non-empty array.");
+    if (!request["object"].HasMember("key") || !request["object"]["key"].IsString())
+      return make_error("Multiple sizes require a single object key.");
+    return process_pyramid(
+      client_, sizes, bucket_name, input_key_prefix, output_key_prefix,
+      request["object"]["key"].GetString(), jpeg_options, decode_mode
+    );
+  }
+
   int width = request["object"]["width"].GetInt();
   int height = request["object"]["height"].GetInt();
 
-  std::string body_str;
+  if (request["object"].HasMember("keys")) {
+    const auto& keys = request["object"]["keys"];
+    if (!keys.IsArray() || keys.Empty())
+      return make_error("Batch keys must be a non-empty array.");
+    return process_batch(
+      client_, keys, bucket_name, input_key_prefix, output_key_prefix,
+      width, height, jpeg_options, decode_mode
+    );
+  }
+
+  std::string image_name = request["object"]["key"].GetString();
+
+  // Input buffer is reused across warm invocations; the object is written into it once.
+  static std::vector<char> input_buffer;
+  std::string_view body;
   uint64_t download_time;
   {
     std::string input_key = input_key_prefix + "/" + image_name;
-    auto ans = client_.download_file(bucket_name, input_key);
-    body_str = std::get<0>(ans);
-    download_time = std::get<1>(ans);
+    std::tie(body, download_time) = client_.download_file(bucket_name, input_key, input_buffer);
 
-    if (body_str.empty()) {
+    if (body.empty()) {
       rapidjson::Document error;
       error.SetObject();
       error.AddMember(
@@ -66,41 +527,34 @@ rapidjson::Document function(const rapidjson::Value& request)
     }
   }
 
-  std::vector<char> vectordata(body_str.begin(), body_str.end());
-
-  uint64_t computing_time;
+  auto ctx = TurboContextPool::acquire();
+  sebs::memory::reset_peak_rss();
+  uint64_t computing_time, peak_rss;
   cv::Mat out_image;
   {
+    sebs::trace::ScopedSpan span("compute");
     auto start_time = timeSinceEpochMicrosec();
-    //thumbnailer(vectordata, width, height, out_image);
-    thumbnailer_fast(vectordata, width, height, out_image);
+    //thumbnailer(body, width, height, out_image);
+    bool decoded = thumbnailer_fast(body, width, height, out_image, *ctx, decode_mode);
     computing_time = timeSinceEpochMicrosec() - start_time;
+    peak_rss = sebs::memory::peak_rss();
+    if (!decoded)
+      return make_error("Failed to decode image: " + image_name);
   }
 
-  std::vector<unsigned char> out_buffer;
-  cv::imencode(".jpg", out_image, out_buffer);
-
-  // Create a unique key name for the output image
-  std::string key_name;
-  std::string key_name2;
+  // Output buffer keeps its capacity across warm invocations.
+  static std::vector<unsigned char> out_buffer;
+  uint64_t encode_time;
   {
-    std::string output_key = output_key_prefix + "/" + image_name;
-    std::string name, extension;
-    if (output_key.find_last_of('.') != std::string::npos) {
-      name = output_key.substr(0, output_key.find_last_of('.'));
-      extension = output_key.substr(output_key.find_last_of('.'));
-    } else {
-      name = output_key;
-      extension = "";
-    }
-    key_name = name + "." +
-               boost::uuids::to_string(boost::uuids::random_generator()()) +
-               extension;
-    key_name2 = name + ".tmp." +
-                boost::uuids::to_string(boost::uuids::random_generator()()) +
-                extension;
+    sebs::trace::ScopedSpan span("encode");
+    auto start_time = timeSinceEpochMicrosec();
+    if (!encode_jpeg(out_image, jpeg_options, *ctx, out_buffer))
+      return make_error("Failed to encode thumbnail: " + image_name);
+    encode_time = timeSinceEpochMicrosec() - start_time;
   }
 
+  std::string key_name = output_key_name(output_key_prefix, image_name);
+
   uint64_t upload_time = client_.upload_random_file(
     bucket_name, key_name, true, reinterpret_cast<char *>(out_buffer.data()),
     out_buffer.size()
@@ -133,7 +587,9 @@ rapidjson::Document function(const rapidjson::Value& request)
   measurements.AddMember("download_time", (int64_t)download_time, alloc);
   measurements.AddMember("upload_time", (int64_t)upload_time, alloc);
   measurements.AddMember("compute_time", (int64_t)computing_time, alloc);
-  measurements.AddMember("download_size", (int64_t)vectordata.size(), alloc);
+  measurements.AddMember("encode_time", (int64_t)encode_time, alloc);
+  measurements.AddMember("peak_rss", (int64_t)peak_rss, alloc);
+  measurements.AddMember("download_size", (int64_t)body.size(), alloc);
   measurements.AddMember("upload_size", (int64_t)out_buffer.size(), alloc);
   val.AddMember("measurement", measurements, alloc);
 
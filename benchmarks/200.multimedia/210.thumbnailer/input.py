@@ -36,6 +36,25 @@ def generate_input(data_dir, size, benchmarks_bucket, input_paths, output_paths,
 def validate_output(data_dir: str | None, input_config: dict, output: dict, language: str, storage = None) -> str | None:
 
     result = output.get('result', {})
+
+    # Batch mode (C++ only) returns one output key per input key,
+    # pyramid mode one output key per requested size.
+    if 'keys' in result:
+        keys = result.get('keys')
+        if not isinstance(keys, list) or len(keys) == 0:
+            return f"Output keys are missing or invalid (value='{keys}')"
+        sizes = input_config.get('object', {}).get('sizes')
+        for idx, key in enumerate(keys):
+            if key is None:
+                continue
+            config = input_config
+            if sizes is not None:
+                config = {**input_config, 'object': {'width': sizes[idx][0], 'height': sizes[idx][1]}}
+            error = validate_output(data_dir, config, {'result': {'key': key}}, language, storage)
+            if error is not None:
+                return error
+        return None
+
     key = result.get('key', '')
 
     if not isinstance(key, str) or len(key) == 0:
@@ -6,14 +6,24 @@
 #include <boost/uuid/uuid_generators.hpp>
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_io.hpp>
+#include <boost/interprocess/streams/bufferstream.hpp>
 
+#include <sys/stat.h>
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <map>
 #include <iostream>
 #include <vector>
 #include <fstream>
 #include <sstream>
+#include <string_view>
 
 #include "utils.hpp"
 #include "storage.hpp"
+#include "preprocess.hpp"
 
 #include <torch/torch.h>
 #include <torch/script.h>
@@ -21,14 +31,35 @@
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/opencv.hpp>
 
-#define kIMAGE_SIZE 224
-#define kCHANNELS 3
-
 std::vector<std::string> load_class_labels(const std::string& json_path);
 
-// Global model to persist between invocations
-static bool model_initialized = false;
-static torch::jit::script::Module model;
+struct ModelVariant {
+  const char* name;
+  const char* file;
+  bool quantized;
+  bool channels_last;
+};
+
+// INT8 variants are TorchScript files quantized ahead of time (see export_models.py);
+// channels_last converts the FP32 model and its inputs to NHWC at load time.
+static const ModelVariant kMODEL_VARIANTS[] = {
+  {"fp32", "resnet50.pt", false, false},
+  {"channels_last", "resnet50.pt", false, true},
+  {"int8_dynamic", "resnet50_int8_dynamic.pt", true, false},
+  {"int8_static", "resnet50_int8_static.pt", true, false},
+};
+
+const ModelVariant* find_model_variant(const std::string& name)
+{
+  for (const auto& variant : kMODEL_VARIANTS) {
+    if (name == variant.name)
+      return &variant;
+  }
+  return nullptr;
+}
+
+// Global models to persist between invocations, by variant name
+static std::map<std::string, torch::jit::script::Module> models;
 static std::vector<std::string> class_labels = load_class_labels("imagenet_class_index.json");
 
 // Load ImageNet class labels
@@ -66,119 +97,526 @@ std::vector<std::string> load_class_labels(const std::string& json_path)
   return labels;
 }
 
-bool load_and_preprocess_image(const std::string& image_data, cv::Mat& processed_image)
+struct ModelLoadTimes {
+  uint64_t download = 0;
+  uint64_t deserialize = 0;
+  uint64_t optimize = 0;
+  uint64_t spill = 0;
+  bool cache_hit = false;
+
+  uint64_t process() const { return deserialize + optimize + spill; }
+};
+
+// Directory for the local copy of the model, SEBS_MODEL_CACHE_DIR (default: /tmp); empty disables it.
+std::string model_cache_path(const std::string& model_path, const std::string& etag)
 {
-  // Decode image from memory
-  std::vector<char> vectordata(image_data.begin(), image_data.end());
-  cv::Mat image = cv::imdecode(cv::Mat(vectordata), cv::IMREAD_COLOR);
+  const char* env = std::getenv("SEBS_MODEL_CACHE_DIR");
+  std::string dir = env ? env : "/tmp";
+  if (dir.empty() || etag.empty())
+    return "";
+
+  std::string name = model_path + "-" + etag;
+  for (char& c : name) {
+    if (!std::isalnum(static_cast<unsigned char>(c)) && c != '.' && c != '-')
+      c = '_';
+  }
+  return dir + "/sebs-model-" + name;
+}
 
-  if (image.empty() || !image.data)
+// Writes the model next to its final path and renames it, so that a partial file is never loaded.
+bool spill_model(std::string_view data, const std::string& path)
+{
+  std::string tmp_path = path + ".tmp";
   {
-    return false;
+    std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!file.write(data.data(), data.size()))
+      return false;
   }
+  return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
 
-  // Convert BGR to RGB
-  cv::cvtColor(image, image, cv::COLOR_BGR2RGB);
+/**
+ * Loads a model variant once per sandbox. A copy in the model cache directory
+ * whose name matches the object's ETag is loaded directly; otherwise the model
+ * is downloaded once, deserialized from memory and spilled to the cache.
+ * The module is frozen, and float variants are optimized for inference,
+ * before first use. Quantized variants are unpacked for the current QEngine.
+ * @return The module, or nullptr on failure.
+ */
+torch::jit::script::Module* load_model_if_needed(
+  sebs::Storage& client, ModelLoadTimes& times,
+  const std::string& bucket, const std::string& model_prefix, const ModelVariant& variant
+)
+{
+  auto it = models.find(variant.name);
+  if (it != models.end())
+    return &it->second;
+
+  sebs::trace::ScopedSpan span("model.load");
+  std::string model_path = model_prefix + "/" + variant.file;
+  torch::jit::script::Module module;
+  try {
+    std::string cache_path = model_cache_path(model_path, client.object_etag(bucket, model_path));
+    torch::jit::script::Module loaded;
+
+    struct stat st;
+    if (!cache_path.empty() && stat(cache_path.c_str(), &st) == 0) {
+      sebs::trace::ScopedSpan deserialize_span("model.deserialize");
+      auto begin = timeSinceEpochMicrosec();
+      loaded = torch::jit::load(cache_path);
+      times.deserialize += timeSinceEpochMicrosec() - begin;
+      times.cache_hit = true;
+    } else {
+      // Only needed until the module is deserialized.
+      static std::vector<char> model_buffer;
+      auto [model_data, download_time] = client.download_file(bucket, model_path, model_buffer);
+      times.download += download_time;
+      if (model_data.empty()) {
+        std::cerr << "Failed to download model from storage: "
+          << model_path << " from bucket: "
+          << bucket << std::endl;
+        return nullptr;
+      }
+
+      {
+        sebs::trace::ScopedSpan deserialize_span("model.deserialize");
+        auto begin = timeSinceEpochMicrosec();
+        boost::interprocess::ibufferstream stream(model_data.data(), model_data.size());
+        loaded = torch::jit::load(stream);
+        times.deserialize += timeSinceEpochMicrosec() - begin;
+      }
+
+      if (!cache_path.empty()) {
+        sebs::trace::ScopedSpan spill_span("model.spill");
+        auto begin = timeSinceEpochMicrosec();
+        if (!spill_model(model_data, cache_path))
+          std::cerr << "Warning: failed to write model cache " << cache_path << std::endl;
+        times.spill += timeSinceEpochMicrosec() - begin;
+      }
+      client.release(model_buffer);
+    }
 
-  // Resize to 256 maintaining aspect ratio
-  int w = image.size().width, h = image.size().height;
-  cv::Size scale((int)256 * ((float)w) / h, 256);
-  cv::resize(image, image, scale);
+    {
+      sebs::trace::ScopedSpan optimize_span("model.optimize");
+      auto begin = timeSinceEpochMicrosec();
+      loaded.eval();
+      if (variant.channels_last) {
+        torch::NoGradGuard no_grad;
+        for (auto parameter : loaded.parameters()) {
+          if (parameter.dim() == 4)
+            parameter.set_data(parameter.contiguous(c10::MemoryFormat::ChannelsLast));
+        }
+      }
+      module = torch::jit::freeze(loaded);
+      if (!variant.quantized)
+        module = torch::jit::optimize_for_inference(module);
+      times.optimize += timeSinceEpochMicrosec() - begin;
+    }
+  }
+  catch (const c10::Error &e)
+  {
+    std::cerr << "Error loading model " << model_path << ": " << e.what() << std::endl;
+    return nullptr;
+  }
+  return &models.emplace(variant.name, std::move(module)).first->second;
+}
 
-  // Center crop to 224x224
-  w = image.size().width;
-  h = image.size().height;
-  int crop_x = (w - kIMAGE_SIZE) / 2;
-  int crop_y = (h - kIMAGE_SIZE) / 2;
-  image = image(cv::Range(crop_y, crop_y + kIMAGE_SIZE),
-                cv::Range(crop_x, crop_x + kIMAGE_SIZE));
+// Kernels for quantized operators: FBGEMM on x86, QNNPACK on ARM, unless the request selects one.
+// Quantized weights are unpacked for the engine active when the model is loaded.
+const char* set_quantized_engine(const std::string& requested)
+{
+#if defined(__aarch64__)
+  bool qnnpack = requested != "fbgemm";
+#else
+  bool qnnpack = requested == "qnnpack";
+#endif
+  at::globalContext().setQEngine(qnnpack ? at::QEngine::QNNPACK : at::QEngine::FBGEMM);
+  return qnnpack ? "qnnpack" : "fbgemm";
+}
 
-  // Convert to float and normalize to [0, 1]
-  image.convertTo(processed_image, CV_32FC3, 1.0f / 255.0f);
+struct Prediction {
+  int idx;
+  std::string class_name;
+  float probability;
+};
 
-  return true;
+// Runs one forward pass over a {N, 3, 224, 224} batch and returns the class probabilities.
+torch::Tensor run_model(torch::jit::script::Module& module, const torch::Tensor& input_tensor, bool channels_last)
+{
+  c10::InferenceMode guard;
+  torch::Tensor input = channels_last ? input_tensor.contiguous(c10::MemoryFormat::ChannelsLast) : input_tensor;
+  return module.forward({input}).toTensor().softmax(1);
 }
 
-void load_model_if_needed(
-  sebs::Storage& client,
-  uint64_t& model_download_time, uint64_t& model_process_time,
-  const std::string& bucket, const std::string& model_path
+// Top-k classes of every image in the batch.
+std::vector<std::vector<Prediction>> top_predictions(const torch::Tensor& output, int top_k)
+{
+  auto [probabilities, indices] = output.topk(top_k, 1);
+  probabilities = probabilities.contiguous();
+  indices = indices.contiguous();
+  const float* probability = probabilities.data_ptr<float>();
+  const int64_t* index = indices.data_ptr<int64_t>();
+
+  std::vector<std::vector<Prediction>> predictions(output.size(0));
+  for (auto& image : predictions) {
+    for (int k = 0; k < top_k; ++k, ++index, ++probability) {
+      int idx = static_cast<int>(*index);
+      std::string class_name = idx < (int)class_labels.size() ? class_labels[idx] : "";
+      image.push_back({idx, class_name, *probability});
+    }
+  }
+  return predictions;
+}
+
+/**
+ * Agreement of a model variant with the FP32 model on the same inputs: the
+ * fraction of images with the same top-1 class and the largest difference
+ * of any class probability. FP32 agrees with itself without a second pass.
+ */
+struct Agreement {
+  // Requested with `object.compare`; the other fields are reported only then.
+  bool compared = false;
+  double top1 = 1.0;
+  double max_abs_diff = 0.0;
+  uint64_t reference_load_time = 0;
+  uint64_t reference_time = 0;
+};
+
+/**
+ * The comparison costs a second model: FP32 is loaded after the request's
+ * measurements are taken, runs without warm-up, and is released afterwards,
+ * so that the memory of the sandbox stays that of the measured variant.
+ */
+bool compare_with_fp32(
+  sebs::Storage& client, const std::string& bucket, const std::string& model_prefix,
+  const ModelVariant& variant, const torch::Tensor& output, const torch::Tensor& input_tensor,
+  Agreement& agreement
 )
 {
-  if (!model_initialized)
-  {
-    auto download_result = client.download_file(bucket, model_path);
-    std::string model_data = std::get<0>(download_result);
-    model_download_time = std::get<1>(download_result);
+  agreement.compared = true;
+  const ModelVariant& fp32 = kMODEL_VARIANTS[0];
+  if (&variant == &fp32)
+    return true;
+
+  sebs::trace::ScopedSpan span("reference");
+  bool resident = models.count(fp32.name);
+  auto begin = timeSinceEpochMicrosec();
+  ModelLoadTimes times;
+  torch::jit::script::Module* reference = load_model_if_needed(client, times, bucket, model_prefix, fp32);
+  agreement.reference_load_time = timeSinceEpochMicrosec() - begin;
+  if (!reference)
+    return false;
 
-    if (model_data.empty())
-    {
-      std::cerr << "Failed to download model from storage: "
-        << model_path << " from bucket: "
-        << bucket << std::endl;
-      return;
-    }
+  begin = timeSinceEpochMicrosec();
+  torch::Tensor expected = run_model(*reference, input_tensor, false);
+  agreement.reference_time = timeSinceEpochMicrosec() - begin;
+  if (!resident)
+    models.erase(fp32.name);
 
-    try {
+  c10::InferenceMode guard;
+  int64_t matching = output.argmax(1).eq(expected.argmax(1)).sum().item<int64_t>();
+  agreement.top1 = static_cast<double>(matching) / output.size(0);
+  agreement.max_abs_diff = (output - expected).abs().max().item<float>();
+  return true;
+}
 
-      std::tie(model_download_time, model_process_time) = client.download_stream(
-        bucket, model_path, [&](std::istream & model_data) mutable {
-          std::cout << "Loading ResNet50 model" << std::endl;
-          model = torch::jit::load(model_data);
-          model.eval();
-        }
-      );
+// Sizes the intra-op pool to the vCPUs granted to the sandbox, once per process.
+int configure_threads()
+{
+  static const int threads = []() {
+    int count = static_cast<int>(sebs::available_cpus());
+    torch::set_num_threads(count);
+    // A single forward pass runs at a time; ResNet has no parallel branches to schedule.
+    torch::set_num_interop_threads(1);
+    return count;
+  }();
+  return threads;
+}
 
-    }
-    catch (const c10::Error &e)
-    {
-      std::cerr << "Error loading model: " << e.what() << std::endl;
-      return;
-    }
-    model_initialized = true;
-    //auto model_process_end = timeSinceEpochMicrosec();
-    //model_process_time = model_process_end - model_process_start;
+// Dummy forward passes after a model is loaded, SEBS_WARMUP_ITERATIONS (default: 0).
+int warmup_iterations()
+{
+  static const int iterations = []() {
+    const char* env = std::getenv("SEBS_WARMUP_ITERATIONS");
+    return env ? std::max(std::atoi(env), 0) : 0;
+  }();
+  return iterations;
+}
+
+struct WarmupTimes {
+  int iterations = 0;
+  uint64_t total = 0;
+  // First and last pass: profiling runs versus steady state.
+  uint64_t first = 0;
+  uint64_t last = 0;
+};
+
+// Forward passes run by each variant in this sandbox, including the warm-up.
+static std::map<std::string, uint64_t> forward_calls;
+
+/**
+ * The TorchScript profiling executor records and specializes the graph in the
+ * first calls of a module, which are much slower than later ones. Running them
+ * on a zero batch right after the load moves that cost out of the request.
+ */
+void warm_up(torch::jit::script::Module& module, const ModelVariant& variant, int64_t batch_size, WarmupTimes& times)
+{
+  int iterations = warmup_iterations();
+  if (iterations == 0)
+    return;
+
+  configure_threads();
+  sebs::trace::ScopedSpan span("model.warmup");
+  torch::Tensor input = torch::zeros({batch_size, kCHANNELS, kIMAGE_SIZE, kIMAGE_SIZE});
+  for (int i = 0; i < iterations; ++i) {
+    auto begin = timeSinceEpochMicrosec();
+    run_model(module, input, variant.channels_last);
+    uint64_t elapsed = timeSinceEpochMicrosec() - begin;
+    if (i == 0)
+      times.first = elapsed;
+    times.last = elapsed;
+    times.total += elapsed;
   }
-  else
-  {
-    model_download_time = 0;
-    model_process_time = 0;
+  times.iterations += iterations;
+  forward_calls[variant.name] += iterations;
+}
+
+struct LoadedModels {
+  torch::jit::script::Module* module = nullptr;
+  const ModelVariant* variant = nullptr;
+  // Engine of quantized operators, fixed by the first quantized variant loaded.
+  const char* qengine = "";
+};
+
+// Loads the requested variant; a model loaded by this call is warmed up with inputs of `batch_size` images.
+bool load_models(
+  sebs::Storage& client, ModelLoadTimes& times, const std::string& bucket,
+  const std::string& model_prefix, const ModelVariant& variant, const std::string& qengine,
+  int64_t batch_size, WarmupTimes& warmup, LoadedModels& out
+)
+{
+  static const char* active_qengine = "";
+  if (variant.quantized && !*active_qengine)
+    active_qengine = set_quantized_engine(qengine);
+
+  bool fresh = !models.count(variant.name);
+
+  out.variant = &variant;
+  out.qengine = active_qengine;
+  out.module = load_model_if_needed(client, times, bucket, model_prefix, variant);
+  if (!out.module)
+    return false;
+
+  if (fresh)
+    warm_up(*out.module, variant, batch_size, warmup);
+  return true;
+}
+
+void add_model_measurements(
+  rapidjson::Value& measurements, const ModelLoadTimes& model_times, const WarmupTimes& warmup,
+  bool first_call, uint64_t peak_rss, const Agreement& agreement, rapidjson::Document::AllocatorType& alloc
+)
+{
+  measurements.AddMember("model_time", (int64_t)model_times.process(), alloc);
+  measurements.AddMember("model_download_time", (int64_t)model_times.download, alloc);
+  measurements.AddMember("model_deserialize_time", (int64_t)model_times.deserialize, alloc);
+  measurements.AddMember("model_optimize_time", (int64_t)model_times.optimize, alloc);
+  measurements.AddMember("model_spill_time", (int64_t)model_times.spill, alloc);
+  measurements.AddMember("model_cache_hit", model_times.cache_hit, alloc);
+  measurements.AddMember("warmup_iterations", warmup.iterations, alloc);
+  measurements.AddMember("warmup_time", (int64_t)warmup.total, alloc);
+  measurements.AddMember("warmup_first_time", (int64_t)warmup.first, alloc);
+  measurements.AddMember("warmup_last_time", (int64_t)warmup.last, alloc);
+  // Whether inference_time includes the profiling runs of a cold module.
+  measurements.AddMember("first_call", first_call, alloc);
+  // Taken before the FP32 reference is loaded.
+  measurements.AddMember("peak_rss", (int64_t)peak_rss, alloc);
+  if (agreement.compared) {
+    measurements.AddMember("top1_agreement", agreement.top1, alloc);
+    measurements.AddMember("max_abs_diff", agreement.max_abs_diff, alloc);
+    measurements.AddMember("reference_load_time", (int64_t)agreement.reference_load_time, alloc);
+    measurements.AddMember("reference_time", (int64_t)agreement.reference_time, alloc);
   }
 }
 
-std::pair<int, std::string> recognize_image(cv::Mat& image)
+rapidjson::Document make_error(const std::string& message)
 {
+  rapidjson::Document error;
+  error.SetObject();
+  error.AddMember("error", rapidjson::Value(message.c_str(), error.GetAllocator()), error.GetAllocator());
+  return error;
+}
 
-  // Preprocess and run inference
-  auto input_tensor = torch::from_blob(image.data, {1, kIMAGE_SIZE, kIMAGE_SIZE, kCHANNELS});
-  input_tensor = input_tensor.permute({0, 3, 1, 2});
+/**
+ * Batch mode: all images are downloaded concurrently, preprocessed in
+ * parallel into one {N, 3, 224, 224} tensor, and classified by a single
+ * forward pass.
+ */
+rapidjson::Document process_batch(
+  sebs::Storage& client, const rapidjson::Value& inputs, const std::string& bucket_name,
+  const std::string& input_prefix, const std::string& model_prefix,
+  const ModelVariant& variant, const std::string& qengine, int top_k, bool compare
+)
+{
+  rapidjson::SizeType count = inputs.Size();
+  std::vector<std::string> input_paths(count);
+  for (rapidjson::SizeType i = 0; i < count; ++i) {
+    if (!inputs[i].IsString())
+      return make_error("Batch inputs must be strings.");
+    input_paths[i] = input_prefix + "/" + inputs[i].GetString();
+  }
 
-  // Normalize with ImageNet mean and std
-  input_tensor[0][0] = input_tensor[0][0].sub_(0.485).div_(0.229);
-  input_tensor[0][1] = input_tensor[0][1].sub_(0.456).div_(0.224);
-  input_tensor[0][2] = input_tensor[0][2].sub_(0.406).div_(0.225);
+  // Buffers are reused across warm invocations; deque keeps their addresses stable.
+  static std::deque<std::vector<char>> image_buffers;
+  while (image_buffers.size() < count)
+    image_buffers.emplace_back();
 
-  // Run inference
-  torch::Tensor output = model.forward({input_tensor}).toTensor();
+  std::vector<std::string_view> images(count);
+  uint64_t download_time;
+  {
+    sebs::trace::ScopedSpan span("download");
+    int32_t parent = span.id();
+    auto begin = timeSinceEpochMicrosec();
+    sebs::parallel_for(count, std::min<size_t>(count, 32), [&](size_t i) {
+      sebs::trace::ScopedSpan image_span("download_image", parent);
+      images[i] = std::get<0>(client.download_file(bucket_name, input_paths[i], image_buffers[i]));
+    });
+    download_time = timeSinceEpochMicrosec() - begin;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    if (images[i].empty())
+      return make_error("Failed to download image from storage: " + input_paths[i]);
+  }
+
+  int threads = configure_threads();
+  const int64_t batch_size = count;
 
-  // Get top prediction
-  auto max_result = output.max(1);
-  int predicted_idx = std::get<1>(max_result).item<int>();
+  ModelLoadTimes model_times;
+  WarmupTimes warmup;
+  LoadedModels loaded;
+  if (!load_models(client, model_times, bucket_name, model_prefix, variant, qengine, batch_size, warmup, loaded))
+    return make_error("Failed to load model");
+
+  auto process_start = timeSinceEpochMicrosec();
+
+  // The batch tensor only grows; smaller batches use a prefix of it.
+  static torch::Tensor batch_buffer;
+  if (!batch_buffer.defined() || batch_buffer.size(0) < batch_size)
+    batch_buffer = torch::empty({batch_size, kCHANNELS, kIMAGE_SIZE, kIMAGE_SIZE});
+  torch::Tensor batch = batch_buffer.narrow(0, 0, batch_size);
+
+  uint64_t preprocess_time;
+  std::vector<char> preprocessed(count);
+  {
+    sebs::trace::ScopedSpan span("preprocess");
+    int32_t parent = span.id();
+    auto begin = timeSinceEpochMicrosec();
+    float* data = batch.data_ptr<float>();
+    sebs::parallel_for(count, threads, [&](size_t i) {
+      sebs::trace::ScopedSpan image_span("preprocess_image", parent);
+      float* out = data + i * kCHANNELS * kIMAGE_SIZE * kIMAGE_SIZE;
+      preprocessed[i] = preprocess_image(images[i], out, PreprocessContext::get());
+    });
+    preprocess_time = timeSinceEpochMicrosec() - begin;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    if (!preprocessed[i])
+      return make_error("Failed to load and preprocess image: " + input_paths[i]);
+  }
 
-  std::string class_name = "";
-  if (predicted_idx >= 0 && predicted_idx < (int)class_labels.size())
+  uint64_t inference_time;
+  torch::Tensor output;
+  bool first_call;
+  std::vector<std::vector<Prediction>> predictions;
   {
-    class_name = class_labels[predicted_idx];
+    sebs::trace::ScopedSpan span("inference");
+    auto begin = timeSinceEpochMicrosec();
+    output = run_model(*loaded.module, batch, variant.channels_last);
+    first_call = forward_calls[variant.name]++ == 0;
+    predictions = top_predictions(output, top_k);
+    inference_time = timeSinceEpochMicrosec() - begin;
   }
+  uint64_t process_time = timeSinceEpochMicrosec() - process_start;
 
-  std::cout << "Predicted class: " << predicted_idx << " - " << class_name << std::endl;
+  uint64_t peak_rss = sebs::memory::peak_rss();
+  Agreement agreement;
+  if (compare && !compare_with_fp32(client, bucket_name, model_prefix, variant, output, batch, agreement))
+    return make_error("Failed to load the FP32 reference model");
 
-  return {predicted_idx, class_name};
+  rapidjson::Document val;
+  val.SetObject();
+  auto& alloc = val.GetAllocator();
+
+  rapidjson::Value results(rapidjson::kArrayType);
+  for (rapidjson::SizeType i = 0; i < count; ++i) {
+    rapidjson::Value entry(rapidjson::kObjectType);
+    entry.AddMember("input", rapidjson::Value(inputs[i].GetString(), alloc), alloc);
+    entry.AddMember("idx", predictions[i][0].idx, alloc);
+    entry.AddMember("class", rapidjson::Value(predictions[i][0].class_name.c_str(), alloc), alloc);
+    rapidjson::Value top(rapidjson::kArrayType);
+    for (auto& prediction : predictions[i]) {
+      rapidjson::Value p(rapidjson::kObjectType);
+      p.AddMember("idx", prediction.idx, alloc);
+      p.AddMember("class", rapidjson::Value(prediction.class_name.c_str(), alloc), alloc);
+      p.AddMember("probability", prediction.probability, alloc);
+      top.PushBack(p, alloc);
+    }
+    entry.AddMember("top_k", top, alloc);
+    results.PushBack(entry, alloc);
+  }
+  rapidjson::Value result(rapidjson::kObjectType);
+  result.AddMember("predictions", results, alloc);
+  result.AddMember("variant", rapidjson::StringRef(variant.name), alloc);
+  result.AddMember("qengine", rapidjson::StringRef(loaded.qengine), alloc);
+  val.AddMember("result", result, alloc);
+
+  rapidjson::Value measurements(rapidjson::kObjectType);
+  measurements.AddMember("download_time", (int64_t)(download_time + model_times.download), alloc);
+  measurements.AddMember("compute_time", (int64_t)(process_time + model_times.process()), alloc);
+  add_model_measurements(measurements, model_times, warmup, first_call, peak_rss, agreement, alloc);
+  measurements.AddMember("preprocess_time", (int64_t)preprocess_time, alloc);
+  measurements.AddMember("inference_time", (int64_t)inference_time, alloc);
+  measurements.AddMember("batch_size", (uint64_t)count, alloc);
+  measurements.AddMember("threads", threads, alloc);
+  val.AddMember("measurement", measurements, alloc);
+
+  return val;
+}
+
+/**
+ * Init hook of the handler: with SEBS_STORAGE_BUCKET and SEBS_MODEL_PREFIX set,
+ * the model (SEBS_MODEL_VARIANT, default: fp32) is loaded and warmed up before
+ * the first request, which then reports no model or warm-up time.
+ */
+void initialize()
+{
+  const char* bucket = std::getenv("SEBS_STORAGE_BUCKET");
+  const char* model_prefix = std::getenv("SEBS_MODEL_PREFIX");
+  if (!bucket || !*bucket || !model_prefix || !*model_prefix)
+    return;
+
+  const char* variant_name = std::getenv("SEBS_MODEL_VARIANT");
+  const ModelVariant* variant = find_model_variant(variant_name ? variant_name : "fp32");
+  if (!variant) {
+    std::cerr << "Unknown model variant: " << variant_name << std::endl;
+    return;
+  }
+  const char* qengine = std::getenv("SEBS_QENGINE");
+
+  ModelLoadTimes model_times;
+  WarmupTimes warmup;
+  LoadedModels loaded;
+  auto begin = timeSinceEpochMicrosec();
+  if (!load_models(sebs::Storage::get_client(), model_times, bucket, model_prefix, *variant,
+                   qengine ? qengine : "", 1, warmup, loaded))
+    return;
+  sebs::cold_start::record("model_load", timeSinceEpochMicrosec() - begin - warmup.total);
+  sebs::cold_start::record("model_warmup", warmup.total);
 }
 
 rapidjson::Document function(const rapidjson::Value& request)
 {
-  static sebs::Storage client = sebs::Storage::get_client();
+  static sebs::Storage& client = sebs::Storage::get_client();
 
   if (!request.HasMember("bucket") || !request["bucket"].IsObject())
   {
@@ -194,14 +632,41 @@ rapidjson::Document function(const rapidjson::Value& request)
   std::string model_prefix = bucket_obj["model"].GetString();
 
   const auto& object_obj = request["object"];
+  // We use a different ResNet format than Python: TorchScript files, one per variant.
+  std::string variant_name = "fp32";
+  if (object_obj.HasMember("variant") && object_obj["variant"].IsString())
+    variant_name = object_obj["variant"].GetString();
+  const ModelVariant* variant = find_model_variant(variant_name);
+  if (!variant)
+    return make_error("Unknown model variant: " + variant_name);
+  std::string qengine;
+  if (object_obj.HasMember("qengine") && object_obj["qengine"].IsString())
+    qengine = object_obj["qengine"].GetString();
+  // Agreement with FP32 loads and runs the FP32 model as well.
+  bool compare = object_obj.HasMember("compare") && object_obj["compare"].IsBool() &&
+    object_obj["compare"].GetBool();
+
+  sebs::memory::reset_peak_rss();
+
+  if (object_obj.HasMember("inputs"))
+  {
+    const auto& inputs = object_obj["inputs"];
+    if (!inputs.IsArray() || inputs.Empty())
+      return make_error("Batch inputs must be a non-empty array.");
+    int top_k = 5;
+    if (object_obj.HasMember("top_k") && object_obj["top_k"].IsInt())
+      top_k = std::min(std::max(object_obj["top_k"].GetInt(), 1), 1000);
+    return process_batch(client, inputs, bucket_name, input_prefix, model_prefix, *variant, qengine, top_k, compare);
+  }
+
   std::string input_key = object_obj["input"].GetString();
-  std::string model_key = object_obj["model"].GetString();
 
-  // Download image from storage
+  // Download image from storage into a buffer reused across warm invocations
+  static std::vector<char> image_buffer;
   std::string input_path = input_prefix + "/" + input_key;
-  auto download_result = client.download_file(bucket_name, input_path);
-  std::string image_data = std::get<0>(download_result);
-  uint64_t image_download_time = std::get<1>(download_result);
+  std::string_view image_data;
+  uint64_t image_download_time;
+  std::tie(image_data, image_download_time) = client.download_file(bucket_name, input_path, image_buffer);
 
   if (image_data.empty())
   {
@@ -218,14 +683,10 @@ rapidjson::Document function(const rapidjson::Value& request)
     return error;
   }
 
-  uint64_t model_download_time = 0;
-  uint64_t model_process_time = 0;
-  // Hardcoded model path - we use a different ResNet format than Python.
-  std::string model_path = model_prefix + "/resnet50.pt";
-
-  load_model_if_needed(client, model_download_time, model_process_time, bucket_name, model_path);
-
-  if (!model_initialized)
+  ModelLoadTimes model_times;
+  WarmupTimes warmup;
+  LoadedModels loaded;
+  if (!load_models(client, model_times, bucket_name, model_prefix, *variant, qengine, 1, warmup, loaded))
   {
     rapidjson::Document error;
     error.SetObject();
@@ -233,12 +694,19 @@ rapidjson::Document function(const rapidjson::Value& request)
     return error;
   }
 
+  configure_threads();
+
   // Process image and run inference (separate timer like Python)
   auto process_start = timeSinceEpochMicrosec();
 
-  // Preprocess the image
-  cv::Mat processed_image;
-  if (!load_and_preprocess_image(image_data, processed_image))
+  // Input tensor is preallocated; preprocessing writes the normalized image into it.
+  static torch::Tensor input_tensor = torch::empty({1, kCHANNELS, kIMAGE_SIZE, kIMAGE_SIZE});
+  bool preprocessed;
+  {
+    sebs::trace::ScopedSpan span("preprocess");
+    preprocessed = preprocess_image(image_data, input_tensor.data_ptr<float>(), PreprocessContext::get());
+  }
+  if (!preprocessed)
   {
     rapidjson::Document error;
     error.SetObject();
@@ -247,33 +715,40 @@ rapidjson::Document function(const rapidjson::Value& request)
   }
 
   // Run inference
-  auto [predicted_idx, class_name] = recognize_image(processed_image);
+  torch::Tensor output;
+  bool first_call;
+  Prediction prediction;
+  {
+    sebs::trace::ScopedSpan span("inference");
+    output = run_model(*loaded.module, input_tensor, variant->channels_last);
+    first_call = forward_calls[variant->name]++ == 0;
+    prediction = top_predictions(output, 1)[0][0];
+  }
+  std::cout << "Predicted class: " << prediction.idx << " - " << prediction.class_name << std::endl;
 
   auto process_end = timeSinceEpochMicrosec();
   uint64_t process_time = process_end - process_start;
 
-  if (predicted_idx < 0)
-  {
-    rapidjson::Document error;
-    error.SetObject();
-    error.AddMember("error", "Image recognition failed", error.GetAllocator());
-    return error;
-  }
+  uint64_t peak_rss = sebs::memory::peak_rss();
+  Agreement agreement;
+  if (compare && !compare_with_fp32(client, bucket_name, model_prefix, *variant, output, input_tensor, agreement))
+    return make_error("Failed to load the FP32 reference model");
 
   rapidjson::Document val;
   val.SetObject();
   auto& alloc = val.GetAllocator();
 
   rapidjson::Value result(rapidjson::kObjectType);
-  result.AddMember("idx", predicted_idx, alloc);
-  result.AddMember("class", rapidjson::Value(class_name.c_str(), alloc), alloc);
+  result.AddMember("idx", prediction.idx, alloc);
+  result.AddMember("class", rapidjson::Value(prediction.class_name.c_str(), alloc), alloc);
+  result.AddMember("variant", rapidjson::StringRef(variant->name), alloc);
+  result.AddMember("qengine", rapidjson::StringRef(loaded.qengine), alloc);
   val.AddMember("result", result, alloc);
 
   rapidjson::Value measurements(rapidjson::kObjectType);
-  measurements.AddMember("download_time", (int64_t)(image_download_time + model_download_time), alloc);
-  measurements.AddMember("compute_time", (int64_t)(process_time + model_process_time), alloc);
-  measurements.AddMember("model_time", (int64_t)model_process_time, alloc);
-  measurements.AddMember("model_download_time", (int64_t)model_download_time, alloc);
+  measurements.AddMember("download_time", (int64_t)(image_download_time + model_times.download), alloc);
+  measurements.AddMember("compute_time", (int64_t)(process_time + model_times.process()), alloc);
+  add_model_measurements(measurements, model_times, warmup, first_call, peak_rss, agreement, alloc);
   val.AddMember("measurement", measurements, alloc);
 
   return val;
@@ -0,0 +1,80 @@
+# Copyright 2020-2025 ETH Zurich and the SeBS authors. All rights reserved.
+"""
+Exports the INT8 TorchScript variants of ResNet50 used by the C++ benchmark.
+
+LibTorch cannot quantize convolutions at runtime, so the variants are
+prepared ahead of time from the same weights as resnet50.pt:
+
+* resnet50_int8_dynamic.pt - dynamic quantization of the fully connected layer.
+* resnet50_int8_static.pt - static quantization of all layers, calibrated
+  on the benchmark images.
+
+Usage: python export_models.py <benchmarks-data>/400.inference/411.image-recognition [--qengine fbgemm|qnnpack]
+
+The files are written to the model directory and uploaded by input.py.
+Quantized weights are packed for the selected engine; use qnnpack for ARM.
+"""
+
+import argparse
+import os
+
+import torch
+import torchvision
+from PIL import Image
+from torchvision import transforms
+
+
+def calibration_images(data_dir):
+    resnet_path = os.path.join(data_dir, 'fake-resnet')
+    preprocess = transforms.Compose([
+        transforms.Resize(256),
+        transforms.CenterCrop(224),
+        transforms.ToTensor(),
+        transforms.Normalize(mean=[0.485, 0.456, 0.406], std=[0.229, 0.224, 0.225]),
+    ])
+    with open(os.path.join(resnet_path, 'val_map.txt'), 'r') as f:
+        for line in f:
+            img = line.split()[0]
+            yield preprocess(Image.open(os.path.join(resnet_path, img)).convert('RGB')).unsqueeze(0)
+
+
+def export(model, path):
+    example = torch.rand(1, 3, 224, 224)
+    with torch.no_grad():
+        traced = torch.jit.trace(model, example)
+    traced.save(path)
+    print(f'Saved {path}')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Export INT8 ResNet50 variants')
+    parser.add_argument('data_dir')
+    parser.add_argument('--qengine', choices=['fbgemm', 'qnnpack'], default='fbgemm')
+    args = parser.parse_args()
+
+    model_dir = os.path.join(args.data_dir, 'model')
+    state_dict = torch.load(os.path.join(model_dir, 'resnet50-19c8e357.pth'))
+    torch.backends.quantized.engine = args.qengine
+
+    model = torchvision.models.resnet50()
+    model.load_state_dict(state_dict)
+    model.eval()
+    dynamic = torch.ao.quantization.quantize_dynamic(model, {torch.nn.Linear}, dtype=torch.qint8)
+    export(dynamic, os.path.join(model_dir, 'resnet50_int8_dynamic.pt'))
+
+    # The quantizable ResNet has the same parameters, plus quant/dequant stubs.
+    model = torchvision.models.quantization.resnet50(quantize=False)
+    model.load_state_dict(state_dict)
+    model.eval()
+    model.fuse_model()
+    model.qconfig = torch.ao.quantization.get_default_qconfig(args.qengine)
+    torch.ao.quantization.prepare(model, inplace=True)
+    with torch.no_grad():
+        for image in calibration_images(args.data_dir):
+            model(image)
+    torch.ao.quantization.convert(model, inplace=True)
+    export(model, os.path.join(model_dir, 'resnet50_int8_static.pt'))
+
+
+if __name__ == '__main__':
+    main()
@@ -19,6 +19,10 @@ expected_results = {
     '800px-Porsche_991_silver_IAA.jpg': {'idx': 817, 'class': 'sports_car'},
 }
 
+def function_environment(input_paths, output_paths):
+    # The C++ handler loads and warms up the model during init.
+    return {'SEBS_MODEL_PREFIX': input_paths[0], 'SEBS_WARMUP_ITERATIONS': '2'}
+
 def generate_input(data_dir, size, benchmarks_bucket, input_paths, output_paths, upload_func, nosql_func):
 
     # upload model
@@ -26,6 +30,11 @@ def generate_input(data_dir, size, benchmarks_bucket, input_paths, output_paths,
     upload_func(0, model_name, os.path.join(data_dir, 'model', model_name))
     model_name_cpp = 'resnet50.pt'
     upload_func(0, model_name_cpp, os.path.join(data_dir, 'model', model_name_cpp))
+    # INT8 variants of the C++ benchmark, when prepared with export_models.py
+    for variant in ['resnet50_int8_dynamic.pt', 'resnet50_int8_static.pt']:
+        variant_path = os.path.join(data_dir, 'model', variant)
+        if os.path.exists(variant_path):
+            upload_func(0, variant, variant_path)
 
     input_images = []
     resnet_path = os.path.join(data_dir, 'fake-resnet')
@@ -46,9 +55,22 @@ def generate_input(data_dir, size, benchmarks_bucket, input_paths, output_paths,
 
 def validate_output(data_dir: str | None, input_config: dict, output: dict, language: str, storage = None) -> str | None:
 
-    image = input_config.get('object', {}).get('input', '')
-
     result = output.get('result', {})
+
+    # Batch mode (C++ only) returns one prediction per input image.
+    if 'predictions' in result:
+        inputs = input_config.get('object', {}).get('inputs', [])
+        predictions = result['predictions']
+        if len(predictions) != len(inputs):
+            return f"Got {len(predictions)} predictions for {len(inputs)} images"
+        for image, prediction in zip(inputs, predictions):
+            config = {**input_config, 'object': {'input': image}}
+            error = validate_output(data_dir, config, {'result': prediction}, language, storage)
+            if error is not None:
+                return error
+        return None
+
+    image = input_config.get('object', {}).get('input', '')
     classification = result.get('class', '')
     idx = result.get('idx', -1)
 
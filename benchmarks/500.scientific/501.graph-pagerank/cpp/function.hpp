@@ -2,56 +2,237 @@
 
 #include <igraph.h>
 
+#include <algorithm>
 #include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <vector>
 
+#include "graph.hpp"
 #include "utils.hpp"
 
-igraph_real_t graph_pagerank
-(int size, uint64_t seed, uint64_t &graph_generation_time_ms, uint64_t &compute_pr_time_ms)
+enum class PagerankEngine { PRPACK, NATIVE };
+enum class GraphGenerator { NATIVE, IGRAPH };
+
+struct PagerankOptions {
+  PagerankEngine engine = PagerankEngine::PRPACK;
+  GraphGenerator generator = GraphGenerator::NATIVE;
+  // Native engine: stops once the L1 norm of the change of ranks drops below tolerance.
+  double tolerance = 1e-10;
+  int max_iterations = 100;
+  size_t threads = 1;
+};
+
+struct PagerankStats {
+  uint64_t graph_generation_time = 0;
+  uint64_t compute_time = 0;
+  // Copying the graph between CSR and igraph, when the engine needs the other one.
+  uint64_t conversion_time = 0;
+  // Native engine only.
+  uint64_t reference_time = 0;
+  int iterations = 0;
+  std::vector<uint64_t> iteration_times;
+  double residual = 0.0;
+  // L1 norm of the difference to the PRPACK ranks.
+  double l1_diff = 0.0;
+};
+
+constexpr igraph_real_t DAMPING = 0.85;
+
+/**
+ * Power iteration in pull form: every vertex sums the contributions
+ * rank[u] / degree(u) of its neighbors, so threads write disjoint ranges of
+ * the new rank vector without synchronization. The rank of dangling
+ * vertices is spread uniformly, as in PRPACK. Vertices are processed in
+ * blocks claimed dynamically, which balances the skewed degrees of
+ * preferential-attachment graphs.
+ */
+std::vector<double> native_pagerank(const sebs::graph::Csr& graph, const PagerankOptions& options, PagerankStats& stats)
+{
+  constexpr size_t BLOCK = 4096;
+  // Independent partial sums let the compiler vectorize reductions without -ffast-math.
+  constexpr size_t LANES = 4;
+
+  const size_t n = graph.vertices;
+  const size_t blocks = (n + BLOCK - 1) / BLOCK;
+  std::vector<double> rank(n, 1.0 / n), next(n), contribution(n), inv_degree(n), dangling(n);
+  for (size_t v = 0; v < n; ++v) {
+    uint32_t degree = graph.offsets[v + 1] - graph.offsets[v];
+    inv_degree[v] = degree ? 1.0 / degree : 0.0;
+    dangling[v] = degree ? 0.0 : 1.0;
+  }
+  std::vector<double> partial(blocks);
+
+  for (stats.iterations = 0; stats.iterations < options.max_iterations; ) {
+    uint64_t begin = timeSinceEpochMicrosec();
+
+    sebs::parallel_for(blocks, options.threads, [&](size_t block) {
+      size_t first = block * BLOCK, last = std::min(first + BLOCK, n);
+      const double* __restrict r = rank.data();
+      const double* __restrict inv = inv_degree.data();
+      const double* __restrict d = dangling.data();
+      double* __restrict c = contribution.data();
+      double sum[LANES] = {};
+      size_t v = first;
+      for (; v + LANES <= last; v += LANES) {
+        for (size_t l = 0; l < LANES; ++l) {
+          c[v + l] = r[v + l] * inv[v + l];
+          sum[l] += r[v + l] * d[v + l];
+        }
+      }
+      for (; v < last; ++v) {
+        c[v] = r[v] * inv[v];
+        sum[0] += r[v] * d[v];
+      }
+      partial[block] = sum[0] + sum[1] + sum[2] + sum[3];
+    });
+    double dangling_rank = 0.0;
+    for (double p : partial)
+      dangling_rank += p;
+    const double base = (1.0 - DAMPING + DAMPING * dangling_rank) / n;
+
+    sebs::parallel_for(blocks, options.threads, [&](size_t block) {
+      size_t first = block * BLOCK, last = std::min(first + BLOCK, n);
+      const uint32_t* offsets = graph.offsets.data();
+      const uint32_t* neighbors = graph.neighbors.data();
+      const double* c = contribution.data();
+      for (size_t v = first; v < last; ++v) {
+        double sum = 0.0;
+        for (uint32_t e = offsets[v]; e < offsets[v + 1]; ++e)
+          sum += c[neighbors[e]];
+        next[v] = sum;
+      }
+
+      const double* __restrict r = rank.data();
+      double* __restrict x = next.data();
+      double diff[LANES] = {};
+      size_t v = first;
+      for (; v + LANES <= last; v += LANES) {
+        for (size_t l = 0; l < LANES; ++l) {
+          x[v + l] = base + DAMPING * x[v + l];
+          diff[l] += std::fabs(x[v + l] - r[v + l]);
+        }
+      }
+      for (; v < last; ++v) {
+        x[v] = base + DAMPING * x[v];
+        diff[0] += std::fabs(x[v] - r[v]);
+      }
+      partial[block] = diff[0] + diff[1] + diff[2] + diff[3];
+    });
+    double residual = 0.0;
+    for (double p : partial)
+      residual += p;
+
+    rank.swap(next);
+    ++stats.iterations;
+    stats.residual = residual;
+    stats.iteration_times.push_back(timeSinceEpochMicrosec() - begin);
+    if (residual < options.tolerance)
+      break;
+  }
+  return rank;
+}
+
+// PRPACK solves the linear system directly; single-threaded.
+bool prpack_pagerank(const igraph_t& graph, igraph_vector_t& pagerank)
+{
+  igraph_real_t value;
+  igraph_pagerank(&graph, IGRAPH_PAGERANK_ALGO_PRPACK,
+                  &pagerank, &value,
+                  igraph_vss_all(), IGRAPH_DIRECTED,
+                  /* damping */ DAMPING, /* weights */ NULL,
+                  NULL /* not needed with PRPACK method */);
+  /* Check that the eigenvalue is 1, as expected. */
+  if (fabs(value - 1.0) > 32*DBL_EPSILON) {
+      fprintf(stderr, "PageRank failed to converge.\n");
+      return false;
+  }
+  return true;
+}
+
+// @return False if the graph cannot be generated; `result` is the rank of vertex 0.
+bool graph_pagerank
+(int size, uint64_t seed, const PagerankOptions& options, PagerankStats& stats, igraph_real_t& result)
 {
+  sebs::graph::Csr csr;
   igraph_t graph;
+  bool has_csr = false, has_igraph = false;
   igraph_vector_t pagerank;
-  igraph_real_t value;
 
-  igraph_rng_seed(igraph_rng_default(), seed);
   {
+    sebs::trace::ScopedSpan span("graph.generate");
     uint64_t start_time = timeSinceEpochMicrosec();
-    igraph_barabasi_game(
-      /* graph=    */ &graph,
-      /* n=        */ size,
-      /* power=    */ 1,
-      /* m=        */ 10,
-      /* outseq=   */ NULL,
-      /* outpref=  */ 0,
-      /* A=        */ 1.0,
-      /* directed= */ 0,
-      /* algo=     */ IGRAPH_BARABASI_PSUMTREE,
-      /* start_from= */ 0
-    );
-    graph_generation_time_ms = (timeSinceEpochMicrosec() - start_time);
+    if (options.generator == GraphGenerator::NATIVE) {
+      if (!sebs::graph::barabasi_albert(size, 10, seed, options.threads, csr)) {
+        return false;
+      }
+      has_csr = true;
+    } else {
+      igraph_rng_seed(igraph_rng_default(), seed);
+      igraph_barabasi_game(
+        /* graph=    */ &graph,
+        /* n=        */ size,
+        /* power=    */ 1,
+        /* m=        */ 10,
+        /* outseq=   */ NULL,
+        /* outpref=  */ 0,
+        /* A=        */ 1.0,
+        /* directed= */ 0,
+        /* algo=     */ IGRAPH_BARABASI_PSUMTREE,
+        /* start_from= */ 0
+      );
+      has_igraph = true;
+    }
+    stats.graph_generation_time = (timeSinceEpochMicrosec() - start_time);
   }
 
+  auto convert = [&]() {
+    sebs::trace::ScopedSpan span("graph.convert");
+    uint64_t start_time = timeSinceEpochMicrosec();
+    if (!has_igraph)
+      sebs::graph::to_igraph(csr, graph);
+    else
+      csr = sebs::graph::from_igraph(graph);
+    has_csr = has_igraph = true;
+    stats.conversion_time += (timeSinceEpochMicrosec() - start_time);
+  };
+
   igraph_vector_init(&pagerank, 0);
-  {
+  result = 1;
+  if (options.engine == PagerankEngine::PRPACK) {
+    if (!has_igraph)
+      convert();
+    sebs::trace::ScopedSpan span("pagerank");
     uint64_t start_time = timeSinceEpochMicrosec();
-    igraph_pagerank(&graph, IGRAPH_PAGERANK_ALGO_PRPACK,
-                    &pagerank, &value,
-                    igraph_vss_all(), IGRAPH_DIRECTED,
-                    /* damping */ 0.85, /* weights */ NULL,
-                    NULL /* not needed with PRPACK method */);
-    compute_pr_time_ms = (timeSinceEpochMicrosec() - start_time);
-  }
-  /* Check that the eigenvalue is 1, as expected. */
-  if (fabs(value - 1.0) > 32*DBL_EPSILON) {
-      fprintf(stderr, "PageRank failed to converge.\n");
-      return 1;
-  }
+    bool converged = prpack_pagerank(graph, pagerank);
+    stats.compute_time = (timeSinceEpochMicrosec() - start_time);
+    if (converged)
+      result = VECTOR(pagerank)[0];
+  } else {
+    if (!has_csr)
+      convert();
+    std::vector<double> ranks;
+    {
+      sebs::trace::ScopedSpan span("pagerank");
+      uint64_t start_time = timeSinceEpochMicrosec();
+      ranks = native_pagerank(csr, options, stats);
+      stats.compute_time = (timeSinceEpochMicrosec() - start_time);
+    }
+    result = ranks.empty() ? 0.0 : ranks[0];
 
-  igraph_real_t result = VECTOR(pagerank)[0];
+    if (!has_igraph)
+      convert();
+    sebs::trace::ScopedSpan span("pagerank.reference");
+    uint64_t start_time = timeSinceEpochMicrosec();
+    if (prpack_pagerank(graph, pagerank)) {
+      for (size_t v = 0; v < ranks.size(); ++v)
+        stats.l1_diff += std::fabs(ranks[v] - VECTOR(pagerank)[v]);
+    }
+    stats.reference_time = (timeSinceEpochMicrosec() - start_time);
+  }
 
   igraph_vector_destroy(&pagerank);
   igraph_destroy(&graph);
-  
-  return result;
-}
 
+  return true;
+}
@@ -13,6 +13,7 @@
 #include <iostream>
 #include <vector>
 #include <climits>  // Required for ULLONG_MAX
+#include <string>
 
 rapidjson::Document function(const rapidjson::Value& request)
 {
@@ -26,18 +27,69 @@ rapidjson::Document function(const rapidjson::Value& request)
     seed = static_cast<uint64_t>(random_value * ULLONG_MAX);
   }
 
-  uint64_t graph_generation_time_ms;
-  uint64_t compute_pr_time_ms;
-  igraph_real_t value = graph_pagerank
-    (size, seed, graph_generation_time_ms, compute_pr_time_ms);
+  // "prpack" (default) or "native": multithreaded CSR power iteration, also compared with PRPACK.
+  PagerankOptions options;
+  if (request.HasMember("engine") && request["engine"].IsString()) {
+    std::string engine = request["engine"].GetString();
+    if (engine == "native") {
+      options.engine = PagerankEngine::NATIVE;
+    } else if (engine != "prpack") {
+      rapidjson::Document error;
+      error.SetObject();
+      error.AddMember("error", rapidjson::Value(("Unknown PageRank engine: " + engine).c_str(), error.GetAllocator()), error.GetAllocator());
+      return error;
+    }
+  }
+  // "native" (default): parallel CSR generator; "igraph": igraph_barabasi_game, as before.
+  if (request.HasMember("generator") && request["generator"].IsString()) {
+    std::string generator = request["generator"].GetString();
+    if (generator == "igraph") {
+      options.generator = GraphGenerator::IGRAPH;
+    } else if (generator != "native") {
+      rapidjson::Document error;
+      error.SetObject();
+      error.AddMember("error", rapidjson::Value(("Unknown graph generator: " + generator).c_str(), error.GetAllocator()), error.GetAllocator());
+      return error;
+    }
+  }
+  if (request.HasMember("tolerance") && request["tolerance"].IsNumber())
+    options.tolerance = request["tolerance"].GetDouble();
+  if (request.HasMember("max_iterations") && request["max_iterations"].IsInt())
+    options.max_iterations = std::max(request["max_iterations"].GetInt(), 1);
+  options.threads = sebs::available_cpus();
+
+  PagerankStats stats;
+  igraph_real_t value;
+  if (!graph_pagerank(size, seed, options, stats, value)) {
+    rapidjson::Document error;
+    error.SetObject();
+    error.AddMember("error", "Graph does not fit 32-bit indices.", error.GetAllocator());
+    return error;
+  }
 
   rapidjson::Document val;
   val.SetObject();
   auto& alloc = val.GetAllocator();
 
   rapidjson::Value measurements(rapidjson::kObjectType);
-  measurements.AddMember("graph_generating_time", (int64_t)graph_generation_time_ms, alloc);
-  measurements.AddMember("compute_time", (int64_t)compute_pr_time_ms, alloc);
+  measurements.AddMember("graph_generating_time", (int64_t)stats.graph_generation_time, alloc);
+  measurements.AddMember("compute_time", (int64_t)stats.compute_time, alloc);
+  measurements.AddMember("graph_conversion_time", (int64_t)stats.conversion_time, alloc);
+  if (options.engine == PagerankEngine::NATIVE) {
+    uint64_t total = 0;
+    rapidjson::Value iteration_times(rapidjson::kArrayType);
+    for (uint64_t time : stats.iteration_times) {
+      total += time;
+      iteration_times.PushBack((int64_t)time, alloc);
+    }
+    measurements.AddMember("reference_time", (int64_t)stats.reference_time, alloc);
+    measurements.AddMember("iterations", stats.iterations, alloc);
+    measurements.AddMember("iteration_time", stats.iterations ? (double)total / stats.iterations : 0.0, alloc);
+    measurements.AddMember("iteration_times", iteration_times, alloc);
+    measurements.AddMember("residual", stats.residual, alloc);
+    measurements.AddMember("l1_diff", stats.l1_diff, alloc);
+    measurements.AddMember("threads", (uint64_t)options.threads, alloc);
+  }
 
   val.AddMember("result", static_cast<double>(value), alloc);
   val.AddMember("measurements", measurements, alloc);
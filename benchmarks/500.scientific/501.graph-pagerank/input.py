@@ -8,6 +8,7 @@ size_generators = {
 
 # Expected pagerank[0] values for Barabasi(size, 10) graphs with seed=42.
 # Computed with igraph using Python's random.seed(42) before graph generation.
+# C++ generates graphs with its own parallel generator unless 'generator' is 'igraph'.
 # Note: Values may vary slightly due to floating-point precision and igraph version differences
 expected_pagerank = {
     "python": {
@@ -16,6 +17,11 @@ expected_pagerank = {
         100000: 0.00033384438552589015,
     },
     "cpp": {
+        10: 0.1,
+        10000: 0.0027214816712931153,
+        100000: 0.00085178865598810783,
+    },
+    "cpp-igraph": {
         10: 0.1,
         10000: 0.0011396482039798725,
         100000: 0.0003105243690874958,
@@ -36,6 +42,8 @@ def validate_output(data_dir: str | None, input_config: dict, output: dict, lang
     size = input_config.get('size')
     seed = input_config.get('seed')
 
+    if language == 'cpp' and input_config.get('generator') == 'igraph':
+        language = 'cpp-igraph'
     expected_result = expected_pagerank[language]
 
     # Verify value match with tolerance for known seeds
@@ -11,7 +11,8 @@ size_generators = {
 # Expected MD5 checksums for deterministic outputs with seed=42
 # Format: checksum of JSON-serialized output (vertex_order, layer_boundaries, parents)
 # Python and C++ may produce different results due to algorithm differences
-# in input generation.
+# in input generation. C++ generates graphs with its own parallel generator
+# unless 'generator' is 'igraph'.
 expected_checksums = {
     'python': {
         10: '1dfb71bebaebcfb1a850f5b81610c2f7',
@@ -19,6 +20,11 @@ expected_checksums = {
         100000: '55cb168c17d2371637f483c720f29dfd',
     },
     'cpp': {
+        10: '1dfb71bebaebcfb1a850f5b81610c2f7',
+        10000: '73804b00a341cf925abad8b21ac51c9d',
+        100000: '17f146fd550fc682bba1a9331bcf6504',
+    },
+    'cpp-igraph': {
         10: '1dfb71bebaebcfb1a850f5b81610c2f7',
         10000: 'dcabd8accdf69b6707dc67f0c769cb4c',
         100000: '5a8a1b56acde2fee8bccc1bf19aeddc5',
@@ -43,6 +49,8 @@ def validate_output(data_dir: str | None, input_config: dict, output: dict, lang
     size = input_config.get('size', 0)
 
     seed = input_config.get('seed')
+    if language == 'cpp' and input_config.get('generator') == 'igraph':
+        language = 'cpp-igraph'
     if seed == 42 and size in expected_checksums[language]:
 
         serialized = json.dumps(result, separators=(',', ':'))
@@ -0,0 +1,262 @@
+// Copyright 2020-2025 ETH Zurich and the SeBS authors. All rights reserved.
+
+#include <algorithm>
+#include <limits>
+
+#include "graph.hpp"
+#include "utils.hpp"
+
+namespace sebs {
+namespace graph {
+
+// Vertices generated as one unit of parallel work.
+constexpr size_t BLOCK = 4096;
+// Upper bound on the number of target ranges of the edge bucketing.
+constexpr size_t MAX_RANGES = 256;
+constexpr uint32_t NO_EDGE = std::numeric_limits<uint32_t>::max();
+
+static uint64_t splitmix64(uint64_t x)
+{
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+// Uniform in [0, bound), without division (Lemire's multiply-shift).
+static uint64_t uniform(uint64_t random, uint64_t bound)
+{
+  return static_cast<uint64_t>((static_cast<unsigned __int128>(random) * bound) >> 64);
+}
+
+// Edges of vertices 1 .. m, which connect to all earlier vertices.
+static uint64_t seed_edges(uint64_t m)
+{
+  return m * (m + 1) / 2;
+}
+
+// Index of the first edge of vertex v >= 1; vertex v has min(v, m) edges.
+static uint64_t first_edge(uint64_t v, uint64_t m)
+{
+  if (v <= m)
+    return (v - 1) * v / 2;
+  return seed_edges(m) + (v - 1 - m) * m;
+}
+
+// Source vertex of edge e.
+static uint64_t edge_source(uint64_t e, uint64_t m)
+{
+  if (e >= seed_edges(m))
+    return m + 1 + (e - seed_edges(m)) / m;
+  uint64_t v = 1;
+  while (first_edge(v + 1, m) <= e)
+    ++v;
+  return v;
+}
+
+/*
+  * Edges are numbered by source vertex, and form a list of 2 * E endpoint
+  * slots, the source and the sampled target. A vertex appears in as many
+  * slots as its degree, so choosing a uniform slot among those of earlier
+  * edges, or one of the earlier vertices with weight 1, is preferential
+  * attachment. A source slot gives its vertex directly; a target slot is
+  * resolved by repeating the sampling of that earlier edge.
+*/
+static uint32_t edge_target(uint64_t e, uint32_t m, uint64_t seed)
+{
+  for (;;) {
+    uint64_t v = edge_source(e, m);
+    if (v <= m)
+      return static_cast<uint32_t>(e - first_edge(v, m));
+
+    uint64_t slots = 2 * first_edge(v, m);
+    uint64_t r = uniform(splitmix64(seed ^ splitmix64(e)), slots + v);
+    if (r >= slots)
+      return static_cast<uint32_t>(r - slots);
+    if (r % 2 == 0)
+      return static_cast<uint32_t>(edge_source(r / 2, m));
+    e = r / 2;
+  }
+}
+
+bool barabasi_albert(uint32_t vertices, uint32_t m, uint64_t seed, size_t threads, Csr& out)
+{
+  out = Csr{};
+  out.vertices = vertices;
+  if (vertices == 0 || m == 0) {
+    out.offsets.assign(static_cast<size_t>(vertices) + 1, 0);
+    return true;
+  }
+
+  const uint64_t edges = first_edge(vertices, m);
+  if (2 * edges >= NO_EDGE)
+    return false;
+
+  const size_t n = vertices;
+  const size_t blocks = (n + BLOCK - 1) / BLOCK;
+  // Edges are bucketed by ranges of 2^shift target vertices: few enough ranges
+  // to count per block, and ranges small enough to be filled within the cache.
+  unsigned shift = 12;
+  while (((n - 1) >> shift) >= MAX_RANGES)
+    ++shift;
+  const size_t ranges = ((n - 1) >> shift) + 1;
+
+  // Targets of each vertex, sorted, with duplicates replaced by NO_EDGE.
+  std::vector<uint32_t> targets(edges);
+  std::vector<uint32_t> degree(n, 0);
+  std::vector<uint32_t> counts(blocks * ranges, 0);
+  sebs::parallel_for(blocks, threads, [&](size_t block) {
+    size_t first = std::max<size_t>(block * BLOCK, 1), last = std::min((block + 1) * BLOCK, n);
+    uint32_t* count = counts.data() + block * ranges;
+    for (size_t v = first; v < last; ++v) {
+      uint64_t begin = first_edge(v, m);
+      uint32_t k = std::min<uint32_t>(v, m);
+      uint32_t* own = targets.data() + begin;
+      for (uint32_t j = 0; j < k; ++j)
+        own[j] = edge_target(begin + j, m, seed);
+
+      std::sort(own, own + k);
+      for (uint32_t j = 0, previous = NO_EDGE; j < k; ++j) {
+        if (own[j] == previous) {
+          own[j] = NO_EDGE;
+          continue;
+        }
+        previous = own[j];
+        ++degree[v];
+        ++count[own[j] >> shift];
+      }
+    }
+  });
+
+  // Edges grouped by target range; within a range, by source block, so that sources ascend.
+  uint64_t total = 0;
+  for (size_t range = 0; range < ranges; ++range) {
+    for (size_t block = 0; block < blocks; ++block) {
+      uint32_t count = counts[block * ranges + range];
+      counts[block * ranges + range] = static_cast<uint32_t>(total);
+      total += count;
+    }
+  }
+  std::vector<uint32_t> range_begin(ranges + 1);
+  for (size_t range = 0; range < ranges; ++range)
+    range_begin[range] = counts[range];
+  range_begin[ranges] = static_cast<uint32_t>(total);
+
+  // (target, source) pairs; the source is sufficient once the pair is in its range.
+  std::vector<uint64_t> incoming(total);
+  sebs::parallel_for(blocks, threads, [&](size_t block) {
+    size_t first = std::max<size_t>(block * BLOCK, 1), last = std::min((block + 1) * BLOCK, n);
+    uint32_t* position = counts.data() + block * ranges;
+    for (size_t v = first; v < last; ++v) {
+      const uint32_t* own = targets.data() + first_edge(v, m);
+      for (uint32_t j = 0; j < std::min<uint32_t>(v, m); ++j) {
+        if (own[j] != NO_EDGE)
+          incoming[position[own[j] >> shift]++] = static_cast<uint64_t>(own[j]) << 32 | v;
+      }
+    }
+  });
+
+  // Ranges own disjoint vertices: in-degrees are counted without atomics.
+  sebs::parallel_for(ranges, threads, [&](size_t range) {
+    for (size_t i = range_begin[range]; i < range_begin[range + 1]; ++i)
+      ++degree[incoming[i] >> 32];
+  });
+
+  // Exclusive prefix sum of degrees: block sums, then each block offsets its own range.
+  out.offsets.resize(n + 1);
+  std::vector<uint32_t> block_begin(blocks + 1, 0);
+  sebs::parallel_for(blocks, threads, [&](size_t block) {
+    uint32_t sum = 0;
+    for (size_t v = block * BLOCK; v < std::min((block + 1) * BLOCK, n); ++v)
+      sum += degree[v];
+    block_begin[block + 1] = sum;
+  });
+  for (size_t block = 0; block < blocks; ++block)
+    block_begin[block + 1] += block_begin[block];
+  sebs::parallel_for(blocks, threads, [&](size_t block) {
+    uint32_t offset = block_begin[block];
+    for (size_t v = block * BLOCK; v < std::min((block + 1) * BLOCK, n); ++v) {
+      out.offsets[v] = offset;
+      offset += degree[v];
+    }
+  });
+  out.offsets[n] = block_begin[blocks];
+
+  // A list holds the earlier neighbors (own targets), then the later ones in
+  // order of the pairs: both parts are sorted, and so is the list.
+  out.neighbors.resize(out.offsets[n]);
+  sebs::parallel_for(ranges, threads, [&](size_t range) {
+    size_t first = range << shift, last = std::min((range + 1) << shift, n);
+    for (size_t v = first; v < last; ++v) {
+      uint32_t position = out.offsets[v];
+      if (v > 0) {
+        const uint32_t* own = targets.data() + first_edge(v, m);
+        for (uint32_t j = 0; j < std::min<uint32_t>(v, m); ++j) {
+          if (own[j] != NO_EDGE)
+            out.neighbors[position++] = own[j];
+        }
+      }
+      // From now on, the next free position in the list of v.
+      degree[v] = position;
+    }
+    for (size_t i = range_begin[range]; i < range_begin[range + 1]; ++i)
+      out.neighbors[degree[incoming[i] >> 32]++] = static_cast<uint32_t>(incoming[i]);
+  });
+  return true;
+}
+
+Csr from_igraph(const igraph_t& graph)
+{
+  Csr csr;
+  csr.vertices = static_cast<uint32_t>(igraph_vcount(&graph));
+  igraph_vector_int_t edges;
+  igraph_vector_int_init(&edges, 0);
+  igraph_get_edgelist(&graph, &edges, 0);
+  size_t endpoints = igraph_vector_int_size(&edges);
+
+  csr.offsets.assign(csr.vertices + 1, 0);
+  for (size_t i = 0; i < endpoints; ++i)
+    ++csr.offsets[VECTOR(edges)[i] + 1];
+  for (uint32_t v = 0; v < csr.vertices; ++v)
+    csr.offsets[v + 1] += csr.offsets[v];
+
+  std::vector<uint32_t> position(csr.offsets.begin(), csr.offsets.end() - 1);
+  csr.neighbors.resize(endpoints);
+  for (size_t i = 0; i < endpoints; i += 2) {
+    uint32_t from = VECTOR(edges)[i];
+    uint32_t to = VECTOR(edges)[i + 1];
+    csr.neighbors[position[from]++] = to;
+    csr.neighbors[position[to]++] = from;
+  }
+  for (uint32_t v = 0; v < csr.vertices; ++v)
+    std::sort(csr.neighbors.begin() + csr.offsets[v], csr.neighbors.begin() + csr.offsets[v + 1]);
+
+  igraph_vector_int_destroy(&edges);
+  return csr;
+}
+
+void to_igraph(const Csr& csr, igraph_t& graph)
+{
+  // Every edge once, from its endpoint with the larger index.
+  igraph_vector_int_t edges;
+  igraph_vector_int_init(&edges, csr.neighbors.size());
+  size_t count = 0;
+  for (uint32_t v = 0; v < csr.vertices; ++v) {
+    for (uint32_t e = csr.offsets[v]; e < csr.offsets[v + 1]; ++e) {
+      uint32_t u = csr.neighbors[e];
+      if (u > v)
+        break;
+      VECTOR(edges)[count++] = v;
+      VECTOR(edges)[count++] = u;
+      // A loop is stored twice in the list of its vertex.
+      if (u == v)
+        ++e;
+    }
+  }
+  igraph_vector_int_resize(&edges, count);
+  igraph_create(&graph, &edges, csr.vertices, IGRAPH_UNDIRECTED);
+  igraph_vector_int_destroy(&edges);
+}
+
+};
+};
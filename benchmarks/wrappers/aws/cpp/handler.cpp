@@ -2,6 +2,9 @@
 #include <chrono>
 #include <cstdlib>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
 
 #ifdef SEBS_USE_AWS_SDK
 #include <aws/core/Aws.h>
@@ -10,26 +13,151 @@
 
 #include <rapidjson/document.h>
 #include <rapidjson/writer.h>
-#include <rapidjson/stringbuffer.h>
 
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_generators.hpp>
 #include <boost/uuid/uuid_io.hpp>
 
+#include "perf-counters.hpp"
+#include "retry.hpp"
+#ifdef SEBS_WITH_STORAGE
+#include "storage.hpp"
+#endif
 #include "utils.hpp"
 
 // Global variables that are retained across function invocations
 bool cold_execution = true;
 std::string container_id = "";
 std::string cold_start_var = "";
+// Enabled with SEBS_PERF_COUNTERS=1.
+std::unique_ptr<sebs::PerfCounters> perf_counters;
+
+// Cold start timeline, all timestamps in microseconds since epoch.
+uint64_t static_init_begin = 0;
+uint64_t main_begin = 0;
+uint64_t sdk_init_end = 0;
+uint64_t runtime_begin = 0;
+uint64_t first_handler_begin = 0;
+
+// Arena for request parsing and response metadata; the first chunk is never released.
+alignas(8) static char arena_chunk[64 * 1024];
+rapidjson::MemoryPoolAllocator<> arena(arena_chunk, sizeof(arena_chunk));
+// Mutable copy of the payload for in-situ parsing; keeps its capacity across invocations.
+std::vector<char> payload_buffer;
+// Largest response so far, used to size the next one in a single allocation.
+size_t response_capacity = 0;
+
+// rapidjson output stream appending to a std::string.
+struct ResponseStream {
+  typedef char Ch;
+  std::string& out;
+  void Put(char c) { out.push_back(c); }
+  void Flush() {}
+};
+
+// Runs before the static initializers of the benchmark; everything earlier is exec and loading.
+__attribute__((constructor(101))) static void mark_static_init() {
+  static_init_begin = timeSinceEpochMicrosec();
+}
 
 rapidjson::Document function(const rapidjson::Value& req);
+// Optional benchmark hook run during init, e.g., to load and warm up a model.
+void initialize() __attribute__((weak));
+
+#ifdef SEBS_WITH_STORAGE
+// Creates the storage client during init and, when SEBS_STORAGE_BUCKET and
+// SEBS_S3_PREWARM_CONNECTIONS are set, opens pooled connections to the bucket.
+// The total is reported as "clients_init": time no longer spent in the first invocation.
+void init_storage() {
+  auto bef = timeSinceEpochMicrosec();
+  auto& storage = sebs::Storage::get_client();
+  const char *bucket = std::getenv("SEBS_STORAGE_BUCKET");
+  const char *connections = std::getenv("SEBS_S3_PREWARM_CONNECTIONS");
+  if (bucket && *bucket && connections) {
+    long count = std::strtol(connections, nullptr, 10);
+    if (count > 0)
+      sebs::cold_start::record("storage_prewarm", storage.prewarm(bucket, count));
+  }
+  sebs::cold_start::record("clients_init", timeSinceEpochMicrosec() - bef);
+}
+#endif
+
+// Serializes the span buffer as a tree; times are nanoseconds relative to the invocation start.
+rapidjson::Value trace_tree(
+  const sebs::trace::Buffer& spans, const std::vector<std::vector<int32_t>>& children,
+  int32_t idx, rapidjson::Document::AllocatorType& alloc
+) {
+  const auto& span = spans[idx];
+  uint64_t end = span.end ? span.end : span.begin;
+
+  rapidjson::Value node(rapidjson::kObjectType);
+  node.AddMember("name", rapidjson::StringRef(span.name), alloc);
+  node.AddMember("begin", span.begin - spans.origin(), alloc);
+  node.AddMember("duration", end - span.begin, alloc);
+  if (!children[idx].empty()) {
+    rapidjson::Value nested(rapidjson::kArrayType);
+    for (int32_t child : children[idx])
+      nested.PushBack(trace_tree(spans, children, child, alloc), alloc);
+    node.AddMember("children", nested, alloc);
+  }
+  return node;
+}
+
+rapidjson::Value cold_start_json(rapidjson::Document::AllocatorType& alloc) {
+  rapidjson::Value timeline(rapidjson::kObjectType);
+  uint64_t process_start = sebs::cold_start::process_start_time();
+
+  timeline.AddMember("process_start", process_start, alloc);
+  timeline.AddMember("main_begin", main_begin, alloc);
+  if (process_start && process_start < main_begin)
+    timeline.AddMember("time_to_main", main_begin - process_start, alloc);
+  timeline.AddMember("static_init", main_begin - static_init_begin, alloc);
+  timeline.AddMember("sdk_init", sdk_init_end - main_begin, alloc);
+  // Runtime registration and fetching the first event from the runtime API.
+  timeline.AddMember("runtime_init", first_handler_begin - runtime_begin, alloc);
+  for (const auto& phase : sebs::cold_start::phases())
+    timeline.AddMember(rapidjson::StringRef(phase.first), phase.second, alloc);
+  return timeline;
+}
+
+rapidjson::Value trace_json(rapidjson::Document::AllocatorType& alloc) {
+  const auto& spans = sebs::trace::Buffer::get();
+  size_t count = spans.size();
+
+  std::vector<std::vector<int32_t>> children(count);
+  std::vector<int32_t> roots;
+  for (size_t i = 0; i < count; ++i) {
+    int32_t parent = spans[i].parent;
+    if (parent >= 0 && static_cast<size_t>(parent) < count)
+      children[parent].push_back(i);
+    else
+      roots.push_back(i);
+  }
+
+  rapidjson::Value tree(rapidjson::kArrayType);
+  for (int32_t root : roots)
+    tree.PushBack(trace_tree(spans, children, root, alloc), alloc);
+
+  rapidjson::Value trace(rapidjson::kObjectType);
+  trace.AddMember("spans", tree, alloc);
+  trace.AddMember("dropped", (uint64_t)spans.dropped(), alloc);
+  return trace;
+}
 
 aws::lambda_runtime::invocation_response handler(
     aws::lambda_runtime::invocation_request const &req
 ) {
-  rapidjson::Document json;
-  json.Parse(req.payload.c_str());
+  if (cold_execution)
+    first_handler_begin = timeSinceEpochMicrosec();
+
+  // Requests are parsed in-situ from a persistent copy of the payload, and all DOM nodes
+  // come from an arena that is reset, not freed, between invocations.
+  arena.Clear();
+  payload_buffer.assign(req.payload.begin(), req.payload.end());
+  payload_buffer.push_back('\0');
+
+  rapidjson::Document json(&arena);
+  json.ParseInsitu(payload_buffer.data());
   if(json.HasParseError()) {
     return aws::lambda_runtime::invocation_response::failure("Invalid JSON", "application/json");
   }
@@ -37,62 +165,137 @@ aws::lambda_runtime::invocation_response handler(
   // HTTP trigger with API Gateway sends payload as a serialized JSON
   // stored under key 'body' in the main JSON
   // The SDK trigger converts everything for us
-  if (json.HasMember("body") && json["body"].IsString()) {
-    rapidjson::Document body_doc;
-    body_doc.Parse(json["body"].GetString());
+  // In-situ parsing left the unescaped body string in our buffer, so it can be parsed in place.
+  rapidjson::Document body_doc(&arena);
+  const rapidjson::Value* request = &json;
+  if (json.IsObject() && json.HasMember("body") && json["body"].IsString()) {
+    body_doc.ParseInsitu(const_cast<char*>(json["body"].GetString()));
     if(body_doc.HasParseError()) {
       return aws::lambda_runtime::invocation_response::failure("Invalid JSON", "application/json");
     }
-
-    json = std::move(body_doc);
+    request = &body_doc;
   }
 
+  sebs::trace::Buffer::get().reset();
+  sebs::retry::reset();
+  sebs::retry::set_deadline(
+    std::chrono::duration_cast<std::chrono::microseconds>(req.deadline.time_since_epoch()).count()
+  );
   const auto begin = std::chrono::system_clock::now();
-  auto ret = function(json);
-  const auto end = std::chrono::system_clock::now();
+  const auto begin_ns = timeMonotonicNanosec();
+  rapidjson::Document ret;
+  if (perf_counters)
+    perf_counters->start();
+  {
+    sebs::trace::ScopedSpan span("function");
+    ret = function(*request);
+  }
+  const auto end_ns = timeMonotonicNanosec();
+  sebs::PerfSample perf_sample;
+  if (perf_counters)
+    perf_sample = perf_counters->stop();
 
+  // Timestamps are kept on the system clock for the client; the duration comes from the
+  // monotonic clock to avoid clock adjustments and double rounding.
   auto b = std::chrono::duration_cast<std::chrono::microseconds>(begin.time_since_epoch()).count() / 1000.0 / 1000.0;
-  auto e = std::chrono::duration_cast<std::chrono::microseconds>(end.time_since_epoch()).count() / 1000.0 / 1000.0;
+  auto e = b + (end_ns - begin_ns) / 1e9;
 
-  rapidjson::Document body;
-  body.SetObject();
-  auto& alloc = body.GetAllocator();
+  // The response is written directly into the payload string, without building
+  // an intermediate document and deep-copying the function's result into it.
+  std::string response;
+  response.reserve(response_capacity);
+  ResponseStream stream{response};
+  rapidjson::Writer<ResponseStream> writer(stream);
 
-  body.AddMember("result", ret, alloc);
-  body.AddMember("begin", b, alloc);
-  body.AddMember("end", e, alloc);
-  body.AddMember("results_time", e - b, alloc);
-  body.AddMember("request_id", rapidjson::Value(req.request_id.c_str(), alloc), alloc);
-  body.AddMember("is_cold", cold_execution, alloc);
-  body.AddMember("container_id", rapidjson::Value(container_id.c_str(), alloc), alloc);
-  body.AddMember("cold_start_var", rapidjson::Value(cold_start_var.c_str(), alloc), alloc);
+  writer.StartObject();
+  writer.Key("body");
+  writer.StartObject();
+
+  writer.Key("result");
+  ret.Accept(writer);
+  writer.Key("begin");
+  writer.Double(b);
+  writer.Key("end");
+  writer.Double(e);
+  writer.Key("results_time");
+  writer.Double((end_ns - begin_ns) / 1e9);
+  if (perf_counters) {
+    writer.Key("perf");
+    writer.StartObject();
+    writer.Key("source");
+    writer.String(perf_sample.source);
+    for (const auto& counter : perf_sample.counters) {
+      writer.Key(counter.first);
+      writer.Uint64(counter.second);
+    }
+    writer.EndObject();
+  }
+  auto retries = sebs::retry::counters();
+  writer.Key("retries");
+  writer.StartObject();
+  writer.Key("attempts");
+  writer.Uint64(retries.attempts);
+  writer.Key("retries");
+  writer.Uint64(retries.retries);
+  writer.Key("backoff_time");
+  writer.Uint64(retries.backoff_time);
+  writer.Key("fatal");
+  writer.Uint64(retries.fatal);
+  writer.Key("exhausted");
+  writer.Uint64(retries.exhausted);
+  writer.EndObject();
+  writer.Key("request_id");
+  writer.String(req.request_id.c_str(), req.request_id.size());
+  writer.Key("is_cold");
+  writer.Bool(cold_execution);
+  writer.Key("container_id");
+  writer.String(container_id.c_str(), container_id.size());
+  writer.Key("cold_start_var");
+  writer.String(cold_start_var.c_str(), cold_start_var.size());
+  writer.Key("trace");
+  trace_json(arena).Accept(writer);
+  if (cold_execution) {
+    writer.Key("cold_start");
+    cold_start_json(arena).Accept(writer);
+  }
+
+  writer.EndObject();
+  writer.EndObject();
 
   // Switch cold execution after the first one.
   if (cold_execution)
     cold_execution = false;
 
-  rapidjson::Document final_result;
-  final_result.SetObject();
-  final_result.AddMember("body", body, final_result.GetAllocator());
-
-  rapidjson::StringBuffer buffer;
-  rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-  final_result.Accept(writer);
-
-  return aws::lambda_runtime::invocation_response::success(buffer.GetString(), "application/json");
+  if (response.size() > response_capacity)
+    response_capacity = response.size();
+  return aws::lambda_runtime::invocation_response::success(std::move(response), "application/json");
 }
 
 int main() {
+  main_begin = timeSinceEpochMicrosec();
 #ifdef SEBS_USE_AWS_SDK
   Aws::SDKOptions options;
   Aws::InitAPI(options);
 #endif
+  sdk_init_end = timeSinceEpochMicrosec();
 
   const char *cold_var = std::getenv("cold_start");
   if (cold_var)
     cold_start_var = cold_var;
+  const char *perf_var = std::getenv("SEBS_PERF_COUNTERS");
+  if (perf_var && std::string(perf_var) == "1")
+    perf_counters.reset(new sebs::PerfCounters());
   container_id = boost::uuids::to_string(boost::uuids::random_generator()());
 
+#ifdef SEBS_WITH_STORAGE
+  init_storage();
+#endif
+  if (initialize) {
+    auto bef = timeSinceEpochMicrosec();
+    initialize();
+    sebs::cold_start::record("function_init", timeSinceEpochMicrosec() - bef);
+  }
+  runtime_begin = timeSinceEpochMicrosec();
   aws::lambda_runtime::run_handler(handler);
 
 #ifdef SEBS_USE_AWS_SDK
@@ -1,21 +1,32 @@
 // Copyright 2020-2025 ETH Zurich and the SeBS authors. All rights reserved.
 
-#include <chrono>
-#include <thread>
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <unordered_map>
 
 #include <aws/core/auth/AWSCredentialsProvider.h>
 #include <aws/core/client/ClientConfiguration.h>
+#include <aws/core/client/AsyncCallerContext.h>
+#include <aws/core/client/DefaultRetryStrategy.h>
 #include <aws/dynamodb/model/AttributeDefinition.h>
+#include <aws/dynamodb/model/BatchGetItemRequest.h>
+#include <aws/dynamodb/model/BatchWriteItemRequest.h>
 #include <aws/dynamodb/model/GetItemRequest.h>
+#include <aws/dynamodb/model/KeysAndAttributes.h>
 #include <aws/dynamodb/model/PutItemRequest.h>
 #include <aws/dynamodb/model/PutItemResult.h>
+#include <aws/dynamodb/model/PutRequest.h>
+#include <aws/dynamodb/model/WriteRequest.h>
 
 #include <boost/interprocess/streams/bufferstream.hpp>
 
 #include "key-value.hpp"
+#include "retry.hpp"
 #include "utils.hpp"
 
 KeyValue::KeyValue() {
+  auto bef = timeSinceEpochMicrosec();
   Aws::Client::ClientConfiguration config;
   // config.region = "eu-central-1";
   config.caFile = "/etc/pki/tls/certs/ca-bundle.crt";
@@ -24,6 +35,9 @@ KeyValue::KeyValue() {
   auto credentialsProvider =
       Aws::MakeShared<Aws::Auth::EnvironmentAWSCredentialsProvider>(TAG);
   _client.reset(new Aws::DynamoDB::DynamoDBClient(credentialsProvider, config));
+  config.retryStrategy = Aws::MakeShared<Aws::Client::DefaultRetryStrategy>(TAG, 0);
+  _single_attempt_client.reset(new Aws::DynamoDB::DynamoDBClient(credentialsProvider, config));
+  sebs::cold_start::record("nosql_client", timeSinceEpochMicrosec() - bef);
 }
 
 uint64_t KeyValue::download_file(Aws::String const &table,
@@ -39,40 +53,32 @@ uint64_t KeyValue::download_file(Aws::String const &table,
   hashKey.SetS(key);
   req.AddKey("key", hashKey);
 
-  auto bef = timeSinceEpochMicrosec();
-  int retries = 0;
-  const int MAX_RETRIES = 1500;
-
-  while (retries < MAX_RETRIES) {
-    auto get_result = _client->GetItem(req);
-    if (get_result.IsSuccess()) {
+  sebs::retry::Policy policy;
+  if (!with_backoff)
+    policy.base_delay = 0;
 
-      // Reference the retrieved fields/values
-      auto result = get_result.GetResult();
-      const Aws::Map<Aws::String, Aws::DynamoDB::Model::AttributeValue> &item =
-          result.GetItem();
-      if (item.size() > 0) {
-        uint64_t finishedTime = timeSinceEpochMicrosec();
-
-        required_retries = retries;
-        // GetReadCapacityUnits returns 0?
-        read_units = result.GetConsumedCapacity().GetCapacityUnits();
+  auto bef = timeSinceEpochMicrosec();
+  // An empty item is retried as well: it may not have been written yet.
+  bool success = sebs::retry::run(policy, [&]() {
+    auto get_result = _single_attempt_client->GetItem(req);
+    if (!get_result.IsSuccess()) {
+      auto verdict = sebs::retry::classify(get_result.GetError());
+      if (verdict == sebs::retry::Verdict::FATAL)
+        std::cerr << "Error: GetItem: " << get_result.GetError().GetMessage()
+                  << std::endl;
+      return verdict;
+    }
 
-        return finishedTime - bef;
-      }
+    // Reference the retrieved fields/values
+    auto &result = get_result.GetResult();
+    if (result.GetItem().empty())
+      return sebs::retry::Verdict::RETRY;
+    // GetReadCapacityUnits returns 0?
+    read_units = result.GetConsumedCapacity().GetCapacityUnits();
+    return sebs::retry::Verdict::SUCCESS;
+  }, required_retries);
 
-    } else {
-      retries += 1;
-      if (with_backoff) {
-        int sleep_time = retries;
-        if (retries > 100) {
-          sleep_time = retries * 2;
-        }
-        std::this_thread::sleep_for(std::chrono::milliseconds(sleep_time));
-      }
-    }
-  }
-  return 0;
+  return success ? timeSinceEpochMicrosec() - bef : 0;
 }
 
 uint64_t KeyValue::upload_file(Aws::String const &table, Aws::String const &key,
@@ -104,3 +110,221 @@ uint64_t KeyValue::upload_file(Aws::String const &table, Aws::String const &key,
 
   return finishedTime - bef;
 }
+
+// BatchGetItem and BatchWriteItem limits per request.
+static const size_t MAX_BATCH_GET = 100;
+static const size_t MAX_BATCH_WRITE = 25;
+
+typedef Aws::Map<Aws::String, Aws::DynamoDB::Model::AttributeValue> Item;
+
+static Item make_key(Aws::String const &key) {
+  Item item;
+  Aws::DynamoDB::Model::AttributeValue value;
+  value.SetS(key);
+  item["key"] = value;
+  return item;
+}
+
+static void read_data(Item const &item, std::string &out) {
+  auto data = item.find("data");
+  if (data == item.end())
+    return;
+  auto &buf = data->second.GetB();
+  out.assign(reinterpret_cast<const char *>(buf.GetUnderlyingData()), buf.GetLength());
+}
+
+uint64_t KeyValue::download_batch(Aws::String const &table,
+                                  std::vector<Aws::String> const &keys,
+                                  std::vector<std::string> &values,
+                                  double &read_units, size_t concurrency) {
+  values.assign(keys.size(), std::string());
+  read_units = 0;
+  std::unordered_map<Aws::String, size_t> index;
+  for (size_t i = 0; i < keys.size(); ++i)
+    index.emplace(keys[i], i);
+
+  size_t batches = (keys.size() + MAX_BATCH_GET - 1) / MAX_BATCH_GET;
+  std::vector<double> units(batches, 0.0);
+  std::atomic<bool> failed{false};
+  auto bef = timeSinceEpochMicrosec();
+
+  sebs::parallel_for(batches, concurrency, [&](size_t batch) {
+    Aws::DynamoDB::Model::KeysAndAttributes pending;
+    size_t end = std::min(keys.size(), (batch + 1) * MAX_BATCH_GET);
+    for (size_t i = batch * MAX_BATCH_GET; i < end; ++i)
+      pending.AddKeys(make_key(keys[i]));
+
+    int retries = 0;
+    // Unprocessed keys are a partial success: DynamoDB asks to back off and send them again.
+    bool success = sebs::retry::run(sebs::retry::Policy{}, [&]() {
+      Aws::DynamoDB::Model::BatchGetItemRequest req;
+      req.AddRequestItems(table, pending);
+      req.SetReturnConsumedCapacity(
+          Aws::DynamoDB::Model::ReturnConsumedCapacity::TOTAL);
+
+      auto outcome = _single_attempt_client->BatchGetItem(req);
+      if (!outcome.IsSuccess()) {
+        auto verdict = sebs::retry::classify(outcome.GetError());
+        if (verdict == sebs::retry::Verdict::FATAL)
+          std::cerr << "Error: BatchGetItem: " << outcome.GetError().GetMessage()
+                    << std::endl;
+        return verdict;
+      }
+
+      auto &result = outcome.GetResult();
+      for (auto &capacity : result.GetConsumedCapacity())
+        units[batch] += capacity.GetCapacityUnits();
+      auto responses = result.GetResponses().find(table);
+      if (responses != result.GetResponses().end()) {
+        for (auto &item : responses->second) {
+          auto key = item.find("key");
+          if (key == item.end())
+            continue;
+          auto pos = index.find(key->second.GetS());
+          if (pos != index.end())
+            read_data(item, values[pos->second]);
+        }
+      }
+
+      auto unprocessed = result.GetUnprocessedKeys().find(table);
+      if (unprocessed == result.GetUnprocessedKeys().end() ||
+          unprocessed->second.GetKeys().empty())
+        return sebs::retry::Verdict::SUCCESS;
+      pending = unprocessed->second;
+      return sebs::retry::Verdict::RETRY;
+    }, retries);
+    if (!success)
+      failed.store(true);
+  });
+
+  uint64_t finishedTime = timeSinceEpochMicrosec();
+  for (double batch_units : units)
+    read_units += batch_units;
+  return failed.load() ? 0 : finishedTime - bef;
+}
+
+uint64_t KeyValue::upload_batch(Aws::String const &table,
+                                std::vector<Aws::String> const &keys,
+                                std::vector<std::string_view> const &values,
+                                double &write_units, size_t concurrency) {
+  write_units = 0;
+  if (keys.size() != values.size()) {
+    std::cerr << "Error: upload_batch called with " << keys.size() << " keys and "
+              << values.size() << " values." << std::endl;
+    return 0;
+  }
+
+  size_t batches = (keys.size() + MAX_BATCH_WRITE - 1) / MAX_BATCH_WRITE;
+  std::vector<double> units(batches, 0.0);
+  std::atomic<bool> failed{false};
+  auto bef = timeSinceEpochMicrosec();
+
+  sebs::parallel_for(batches, concurrency, [&](size_t batch) {
+    Aws::Vector<Aws::DynamoDB::Model::WriteRequest> pending;
+    size_t end = std::min(keys.size(), (batch + 1) * MAX_BATCH_WRITE);
+    for (size_t i = batch * MAX_BATCH_WRITE; i < end; ++i) {
+      Item item = make_key(keys[i]);
+      Aws::DynamoDB::Model::AttributeValue data;
+      data.SetB(Aws::Utils::ByteBuffer(
+          reinterpret_cast<const unsigned char *>(values[i].data()), values[i].size()));
+      item["data"] = data;
+      pending.push_back(Aws::DynamoDB::Model::WriteRequest().WithPutRequest(
+          Aws::DynamoDB::Model::PutRequest().WithItem(item)));
+    }
+
+    int retries = 0;
+    bool success = sebs::retry::run(sebs::retry::Policy{}, [&]() {
+      Aws::DynamoDB::Model::BatchWriteItemRequest req;
+      req.AddRequestItems(table, pending);
+      req.SetReturnConsumedCapacity(
+          Aws::DynamoDB::Model::ReturnConsumedCapacity::TOTAL);
+
+      auto outcome = _single_attempt_client->BatchWriteItem(req);
+      if (!outcome.IsSuccess()) {
+        auto verdict = sebs::retry::classify(outcome.GetError());
+        if (verdict == sebs::retry::Verdict::FATAL)
+          std::cerr << "Error: BatchWriteItem: " << outcome.GetError().GetMessage()
+                    << std::endl;
+        return verdict;
+      }
+
+      auto &result = outcome.GetResult();
+      for (auto &capacity : result.GetConsumedCapacity())
+        units[batch] += capacity.GetCapacityUnits();
+      auto unprocessed = result.GetUnprocessedItems().find(table);
+      if (unprocessed == result.GetUnprocessedItems().end() ||
+          unprocessed->second.empty())
+        return sebs::retry::Verdict::SUCCESS;
+      pending = unprocessed->second;
+      return sebs::retry::Verdict::RETRY;
+    }, retries);
+    if (!success)
+      failed.store(true);
+  });
+
+  uint64_t finishedTime = timeSinceEpochMicrosec();
+  for (double batch_units : units)
+    write_units += batch_units;
+  return failed.load() ? 0 : finishedTime - bef;
+}
+
+std::future<std::tuple<std::string, uint64_t>> KeyValue::download_file_async(
+    Aws::String const &table, Aws::String const &key) {
+  Aws::DynamoDB::Model::GetItemRequest req;
+  req.SetTableName(table);
+  Aws::DynamoDB::Model::AttributeValue hashKey;
+  hashKey.SetS(key);
+  req.AddKey("key", hashKey);
+
+  // The promise is shared, as the SDK copies the handler.
+  auto promise = std::make_shared<std::promise<std::tuple<std::string, uint64_t>>>();
+  auto future = promise->get_future();
+  auto bef = timeSinceEpochMicrosec();
+  _client->GetItemAsync(req,
+    [promise, bef](const Aws::DynamoDB::DynamoDBClient *,
+                   const Aws::DynamoDB::Model::GetItemRequest &,
+                   const Aws::DynamoDB::Model::GetItemOutcome &outcome,
+                   const std::shared_ptr<const Aws::Client::AsyncCallerContext> &) {
+      uint64_t finishedTime = timeSinceEpochMicrosec();
+      std::string data;
+      if (!outcome.IsSuccess()) {
+        std::cerr << "Error: GetItem: " << outcome.GetError().GetMessage() << std::endl;
+        promise->set_value({std::move(data), 0});
+        return;
+      }
+      read_data(outcome.GetResult().GetItem(), data);
+      promise->set_value({std::move(data), finishedTime - bef});
+    });
+  return future;
+}
+
+std::future<uint64_t> KeyValue::upload_file_async(Aws::String const &table,
+                                                  Aws::String const &key,
+                                                  std::string_view data) {
+  Aws::DynamoDB::Model::PutItemRequest req;
+  req.SetTableName(table);
+  Aws::DynamoDB::Model::AttributeValue av;
+  av.SetB(Aws::Utils::ByteBuffer(
+      reinterpret_cast<const unsigned char *>(data.data()), data.size()));
+  req.AddItem("data", av);
+  av.SetS(key);
+  req.AddItem("key", av);
+
+  auto promise = std::make_shared<std::promise<uint64_t>>();
+  auto future = promise->get_future();
+  auto bef = timeSinceEpochMicrosec();
+  _client->PutItemAsync(req,
+    [promise, bef](const Aws::DynamoDB::DynamoDBClient *,
+                   const Aws::DynamoDB::Model::PutItemRequest &,
+                   const Aws::DynamoDB::Model::PutItemOutcome &outcome,
+                   const std::shared_ptr<const Aws::Client::AsyncCallerContext> &) {
+      uint64_t finishedTime = timeSinceEpochMicrosec();
+      if (!outcome.IsSuccess()) {
+        std::cerr << "Error: PutItem: " << outcome.GetError().GetMessage() << std::endl;
+        promise->set_value(0);
+        return;
+      }
+      promise->set_value(finishedTime - bef);
+    });
+  return future;
+}
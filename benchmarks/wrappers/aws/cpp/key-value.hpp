@@ -1,32 +1,82 @@
 // Copyright 2020-2025 ETH Zurich and the SeBS authors. All rights reserved.
 
 #include <cstdint>
+#include <future>
 #include <string>
+#include <string_view>
 #include <initializer_list>
 #include <memory>
+#include <tuple>
+#include <vector>
 
 #include <aws/core/utils/memory/stl/AWSString.h>
 #include <aws/dynamodb/DynamoDBClient.h>
 
+/**
+ * Items are stored with the string hash key "key" and a binary attribute "data".
+ */
 class KeyValue
 {
   // non-copyable, non-movable
   std::shared_ptr<Aws::DynamoDB::DynamoDBClient> _client;
+  // Same configuration without SDK retries, for requests retried by sebs::retry.
+  std::shared_ptr<Aws::DynamoDB::DynamoDBClient> _single_attempt_client;
 public:
 
   KeyValue();
 
-uint64_t download_file(Aws::String const &bucket,
+uint64_t download_file(Aws::String const &table,
                         Aws::String const &key,
                         int& required_retries,
                         double& read_units,
                         bool with_backoff = false);
 
-uint64_t upload_file(Aws::String const &bucket,
+uint64_t upload_file(Aws::String const &table,
                         Aws::String const &key,
                           double& write_units,
                           int size,
                           unsigned char* pBuf);
 
-};
+/*
+  * Reads many items with BatchGetItem, up to 100 keys per request and at
+  * most `concurrency` requests in flight. Unprocessed keys returned by
+  * DynamoDB are requested again with backoff. Keys must be unique.
+  * @param values Receives the data of each key, empty when the item does not exist.
+  * @return Elapsed time in microseconds, 0 on failure.
+*/
+uint64_t download_batch(Aws::String const &table,
+                        std::vector<Aws::String> const &keys,
+                        std::vector<std::string> &values,
+                        double& read_units,
+                        size_t concurrency = 8);
+
+/*
+  * Writes many items with BatchWriteItem, up to 25 items per request and at
+  * most `concurrency` requests in flight. Unprocessed items are written
+  * again with backoff. `keys` and `values` have the same length.
+  * @return Elapsed time in microseconds, 0 on failure.
+*/
+uint64_t upload_batch(Aws::String const &table,
+                        std::vector<Aws::String> const &keys,
+                        std::vector<std::string_view> const &values,
+                        double& write_units,
+                        size_t concurrency = 8);
+
+/*
+  * Non-blocking GetItem, so that many requests can be in flight at once.
+  * The future yields the item's data (empty when missing or on failure) and
+  * the latency of the request in microseconds, measured on completion.
+  * The KeyValue instance must outlive the returned future.
+*/
+std::future<std::tuple<std::string, uint64_t>> download_file_async(Aws::String const &table,
+                        Aws::String const &key);
 
+/*
+  * Non-blocking PutItem; `data` is copied into the request before returning.
+  * The future yields the latency in microseconds, 0 on failure.
+*/
+std::future<uint64_t> upload_file_async(Aws::String const &table,
+                        Aws::String const &key,
+                        std::string_view data);
+
+};
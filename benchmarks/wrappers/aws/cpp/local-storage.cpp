@@ -0,0 +1,331 @@
+// Copyright 2020-2025 ETH Zurich and the SeBS authors. All rights reserved.
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <thread>
+
+#include "local-storage.hpp"
+#include "retry.hpp"
+#include "utils.hpp"
+
+namespace {
+
+// Maps a whole file read-only; `populate` reads it in before returning.
+bool map_file(std::string const &path, char *&data, size_t &size, bool populate) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+  size = st.st_size;
+  data = nullptr;
+  // Empty files cannot be mapped, but they are valid objects.
+  if (size > 0) {
+    void *addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | (populate ? MAP_POPULATE : 0), fd, 0);
+    if (addr == MAP_FAILED) {
+      close(fd);
+      return false;
+    }
+    data = static_cast<char*>(addr);
+  }
+  close(fd);
+  return true;
+}
+
+void unmap_file(char *data, size_t size) {
+  if (data)
+    munmap(data, size);
+}
+
+// mkdir -p for the directory part of `path`.
+bool make_parent_directories(std::string const &path) {
+  for (size_t pos = path.find('/', 1); pos != std::string::npos; pos = path.find('/', pos + 1)) {
+    std::string dir = path.substr(0, pos);
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+      return false;
+  }
+  return true;
+}
+
+std::string temporary_path(std::string const &path) {
+  std::ostringstream name;
+  name << path << ".tmp." << getpid() << "." << std::this_thread::get_id();
+  return name.str();
+}
+
+bool write_all(int fd, const char *data, size_t size, off_t offset) {
+  while (size > 0) {
+    ssize_t written = pwrite(fd, data, size, offset);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    data += written;
+    size -= written;
+    offset += written;
+  }
+  return true;
+}
+
+}  // namespace
+
+sebs::LocalStorage::LocalStorage(std::string root):
+  _root(std::move(root))
+{}
+
+std::string sebs::LocalStorage::path(std::string const &bucket,
+                                     std::string const &key) const {
+  return _root + "/" + bucket + "/" + key;
+}
+
+uint64_t sebs::LocalStorage::download_file(std::string const &bucket,
+                                     std::string const &key, int &required_retries,
+                                     bool report_dl_time,
+                                     std::iostream &output_stream) {
+  sebs::trace::ScopedSpan span("storage.download");
+  std::string file_path = path(bucket, key);
+  auto bef = timeSinceEpochMicrosec();
+
+  // A missing file is retried: the object may not have been written yet.
+  bool success = sebs::retry::run(sebs::retry::Policy{}, [&]() {
+    std::ifstream file(file_path, std::ios::binary);
+    if (!file.is_open()) {
+      if (errno == ENOENT)
+        return sebs::retry::Verdict::RETRY;
+      std::cerr << "Error: open " << file_path << ": " << std::strerror(errno) << std::endl;
+      return sebs::retry::Verdict::FATAL;
+    }
+    output_stream.clear();
+    output_stream << file.rdbuf();
+    return sebs::retry::Verdict::SUCCESS;
+  }, required_retries);
+  if (!success)
+    return 0;
+
+  uint64_t finishedTime = timeSinceEpochMicrosec();
+  return report_dl_time ? finishedTime - bef : finishedTime;
+}
+
+std::tuple<std::string, uint64_t> sebs::LocalStorage::download_file(
+    std::string const &bucket, std::string const &key) {
+  sebs::trace::ScopedSpan span("storage.download");
+  auto bef = timeSinceEpochMicrosec();
+
+  std::ifstream file(path(bucket, key), std::ios::binary);
+  if (!file.is_open()) {
+    std::cerr << "Error: open " << path(bucket, key) << ": "
+              << std::strerror(errno) << std::endl;
+    return {"", 0};
+  }
+  std::string content((std::istreambuf_iterator<char>(file)),
+                      std::istreambuf_iterator<char>());
+  return {content, timeSinceEpochMicrosec() - bef};
+}
+
+std::string sebs::LocalStorage::object_etag(std::string const &bucket,
+                                           std::string const &key) {
+  struct stat st;
+  if (stat(path(bucket, key).c_str(), &st) != 0)
+    return "";
+  return std::to_string(st.st_size) + "-" + std::to_string(st.st_mtim.tv_sec) + "." +
+         std::to_string(st.st_mtim.tv_nsec);
+}
+
+std::tuple<std::string_view, uint64_t> sebs::LocalStorage::download_file(
+    std::string const &bucket, std::string const &key, std::vector<char> &buffer) {
+  sebs::trace::ScopedSpan span("storage.download");
+  std::vector<PartTiming> parts;
+  return copy_file(path(bucket, key), buffer, std::numeric_limits<size_t>::max(), 1, span.id(), parts);
+}
+
+std::tuple<std::string_view, uint64_t> sebs::LocalStorage::download_file_parallel(
+    std::string const &bucket, std::string const &key, std::vector<char> &buffer,
+    TransferConfig const &config, std::vector<PartTiming> &parts) {
+  sebs::trace::ScopedSpan span("storage.download_parallel");
+  return copy_file(path(bucket, key), buffer, std::max<size_t>(config.part_size, 1),
+                   config.concurrency, span.id(), parts);
+}
+
+std::tuple<std::string_view, uint64_t> sebs::LocalStorage::copy_file(
+    std::string const &file_path, std::vector<char> &buffer, size_t part_size,
+    size_t concurrency, int32_t parent, std::vector<PartTiming> &parts) {
+  parts.clear();
+  auto bef = timeSinceEpochMicrosec();
+
+  // A lazy mapping: each part is read in by the thread copying it.
+  char *data;
+  size_t size;
+  if (!map_file(file_path, data, size, false)) {
+    std::cerr << "Error: mmap " << file_path << ": " << std::strerror(errno) << std::endl;
+    buffer.clear();
+    return {std::string_view{}, 0};
+  }
+  buffer.resize(size);
+
+  size_t parts_count = size == 0 ? 0 : (size - 1) / part_size + 1;
+  parts.resize(parts_count);
+  sebs::parallel_for(parts_count, concurrency, [&](size_t idx) {
+    sebs::trace::ScopedSpan part_span("storage.download_part", parent);
+    size_t offset = idx * part_size;
+    size_t part = std::min(part_size, size - offset);
+    auto part_bef = timeSinceEpochMicrosec();
+    std::memcpy(buffer.data() + offset, data + offset, part);
+    parts[idx] = {offset, part, timeSinceEpochMicrosec() - part_bef};
+  });
+  unmap_file(data, size);
+
+  return {std::string_view(buffer.data(), buffer.size()), timeSinceEpochMicrosec() - bef};
+}
+
+std::tuple<uint64_t, uint64_t> sebs::LocalStorage::download_stream(
+    std::string const &bucket, std::string const &key,
+    std::function<void(std::istream&)> const &f) {
+  auto bef = timeSinceEpochMicrosec();
+  std::ifstream file;
+  {
+    sebs::trace::ScopedSpan span("storage.download");
+    file.open(path(bucket, key), std::ios::binary);
+  }
+  if (!file.is_open()) {
+    std::cerr << "Error: open " << path(bucket, key) << ": "
+              << std::strerror(errno) << std::endl;
+    return {0, 0};
+  }
+  uint64_t finished_download = timeSinceEpochMicrosec();
+
+  auto bef_compute = timeSinceEpochMicrosec();
+  {
+    sebs::trace::ScopedSpan span("storage.consume");
+    f(file);
+  }
+  uint64_t finished_compute = timeSinceEpochMicrosec();
+
+  return {finished_download - bef, finished_compute - bef_compute};
+}
+
+std::tuple<uint64_t, uint64_t> sebs::LocalStorage::download_chunks(
+    std::string const &bucket, std::string const &key,
+    std::function<bool(std::string_view)> const &consume,
+    StreamConfig const &config) {
+  sebs::trace::ScopedSpan span("storage.download_chunks");
+  auto bef = timeSinceEpochMicrosec();
+
+  // Chunks are slices of a lazy mapping: pages are read in as the consumer reaches them.
+  char *data;
+  size_t size;
+  if (!map_file(path(bucket, key), data, size, false)) {
+    std::cerr << "Error: mmap " << path(bucket, key) << ": "
+              << std::strerror(errno) << std::endl;
+    return {0, 0};
+  }
+  if (data)
+    madvise(data, size, MADV_SEQUENTIAL);
+
+  uint64_t compute_time = 0;
+  {
+    sebs::trace::ScopedSpan consume_span("storage.consume");
+    size_t chunk_size = std::max<size_t>(config.chunk_size, 1);
+    for (size_t offset = 0; offset < size; offset += chunk_size) {
+      auto bef_compute = timeSinceEpochMicrosec();
+      bool proceed = consume(std::string_view(data + offset, std::min(chunk_size, size - offset)));
+      compute_time += timeSinceEpochMicrosec() - bef_compute;
+      if (!proceed)
+        break;
+    }
+  }
+  unmap_file(data, size);
+
+  return {timeSinceEpochMicrosec() - bef, compute_time};
+}
+
+uint64_t sebs::LocalStorage::upload_random_file(std::string const &bucket,
+                                     std::string const &key,
+                                     bool report_dl_time,
+                                     char * data,
+                                     size_t data_size) {
+  if (data == nullptr || data_size == 0) {
+    std::cerr << "Error: upload_random_file called with null data or zero size."
+              << std::endl;
+    return 0;
+  }
+  std::vector<PartTiming> parts;
+  TransferConfig config;
+  config.multipart_threshold = data_size + 1;
+  uint64_t bef_upload = timeSinceEpochMicrosec();
+  if (upload_file_parallel(bucket, key, data, data_size, config, parts) == 0)
+    return 0;
+  uint64_t finishedTime = timeSinceEpochMicrosec();
+  return report_dl_time ? finishedTime - bef_upload : finishedTime;
+}
+
+uint64_t sebs::LocalStorage::upload_file_parallel(std::string const &bucket,
+                                       std::string const &key,
+                                       const char * data,
+                                       size_t data_size,
+                                       TransferConfig const &config,
+                                       std::vector<PartTiming> &parts) {
+  parts.clear();
+  if (data == nullptr || data_size == 0) {
+    std::cerr << "Error: upload_file_parallel called with null data or zero size."
+              << std::endl;
+    return 0;
+  }
+  sebs::trace::ScopedSpan span("storage.upload");
+  std::string file_path = path(bucket, key);
+  std::string tmp_path = temporary_path(file_path);
+  auto bef = timeSinceEpochMicrosec();
+
+  int fd = -1;
+  if (make_parent_directories(file_path))
+    fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    std::cerr << "Error: open " << tmp_path << ": " << std::strerror(errno) << std::endl;
+    return 0;
+  }
+
+  size_t part_size = data_size < config.multipart_threshold ? data_size
+                                                            : std::max<size_t>(config.part_size, 1);
+  size_t parts_count = (data_size + part_size - 1) / part_size;
+  parts.resize(parts_count);
+  int32_t parent = span.id();
+  std::atomic<bool> failed{false};
+  sebs::parallel_for(parts_count, config.concurrency, [&](size_t idx) {
+    sebs::trace::ScopedSpan part_span("storage.upload_part", parent);
+    size_t offset = idx * part_size;
+    size_t size = std::min(part_size, data_size - offset);
+    auto part_bef = timeSinceEpochMicrosec();
+    if (failed.load() || !write_all(fd, data + offset, size, offset)) {
+      failed.store(true);
+      parts[idx] = {offset, size, 0};
+      return;
+    }
+    parts[idx] = {offset, size, timeSinceEpochMicrosec() - part_bef};
+  });
+
+  bool success = !failed.load() && close(fd) == 0;
+  if (success)
+    success = rename(tmp_path.c_str(), file_path.c_str()) == 0;
+  else if (failed.load())
+    close(fd);
+  if (!success) {
+    std::cerr << "Error: write " << file_path << ": " << std::strerror(errno) << std::endl;
+    unlink(tmp_path.c_str());
+    return 0;
+  }
+  return timeSinceEpochMicrosec() - bef;
+}
@@ -0,0 +1,86 @@
+// Copyright 2020-2025 ETH Zurich and the SeBS authors. All rights reserved.
+#ifndef LOCAL_STORAGE_HPP
+#define LOCAL_STORAGE_HPP
+
+#include <string>
+
+#include "storage.hpp"
+
+namespace sebs {
+
+/**
+ * Storage backend serving objects from <root>/<bucket>/<key> on the local
+ * filesystem, to measure benchmarks without network transfers.
+ * Files are mapped and copied into the caller's buffer, or passed to
+ * download_chunks as views of the mapping; uploads are written to a temporary
+ * file and renamed, so readers never see partial objects.
+ */
+class LocalStorage : public Storage
+{
+public:
+  explicit LocalStorage(std::string root);
+
+  uint64_t download_file(std::string const &bucket,
+                          std::string const &key,
+                          int &required_retries,
+                          bool report_dl_time,
+                          std::iostream &output_stream) override;
+
+  std::tuple<std::string, uint64_t> download_file(std::string const &bucket,
+                          std::string const &key) override;
+
+  std::tuple<std::string_view, uint64_t> download_file(std::string const &bucket,
+                          std::string const &key,
+                          std::vector<char> &buffer) override;
+
+  // Parts of the mapping are copied into `buffer` concurrently.
+  std::tuple<std::string_view, uint64_t> download_file_parallel(std::string const &bucket,
+                          std::string const &key,
+                          std::vector<char> &buffer,
+                          TransferConfig const &config,
+                          std::vector<PartTiming> &parts) override;
+
+  std::tuple<uint64_t, uint64_t> download_stream(std::string const &bucket,
+                          std::string const &key,
+                          std::function<void(std::istream&)> const &f) override;
+
+  std::tuple<uint64_t, uint64_t> download_chunks(std::string const &bucket,
+                          std::string const &key,
+                          std::function<bool(std::string_view)> const &consume,
+                          StreamConfig const &config = StreamConfig{}) override;
+
+  uint64_t upload_random_file(std::string const &bucket,
+                          std::string const &key,
+                          bool report_dl_time,
+                          char * data,
+                          size_t data_size) override;
+
+  // Parts are written concurrently with pwrite into one preallocated file.
+  uint64_t upload_file_parallel(std::string const &bucket,
+                          std::string const &key,
+                          const char * data,
+                          size_t data_size,
+                          TransferConfig const &config,
+                          std::vector<PartTiming> &parts) override;
+
+  // Size and modification time of the file.
+  std::string object_etag(std::string const &bucket,
+                          std::string const &key) override;
+
+private:
+  std::string path(std::string const &bucket, std::string const &key) const;
+
+  // Copies the file into `buffer` in parts of `part_size`, on at most `concurrency` threads.
+  std::tuple<std::string_view, uint64_t> copy_file(std::string const &file_path,
+                          std::vector<char> &buffer,
+                          size_t part_size,
+                          size_t concurrency,
+                          int32_t parent,
+                          std::vector<PartTiming> &parts);
+
+  std::string _root;
+};
+
+};
+
+#endif
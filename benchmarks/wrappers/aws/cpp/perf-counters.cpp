@@ -0,0 +1,140 @@
+// Copyright 2020-2025 ETH Zurich and the SeBS authors. All rights reserved.
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include "perf-counters.hpp"
+
+namespace {
+
+const char* const HW_NAMES[] = {"cycles", "instructions", "llc_misses", "branch_misses"};
+const char* const SW_NAMES[] = {"context_switches", "minor_faults", "major_faults"};
+
+int open_counter(uint32_t type, uint64_t config, int group_fd) {
+  struct perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = group_fd == -1 ? 1 : 0;
+  attr.inherit = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+
+// Scales the value when the kernel multiplexed the counter.
+bool read_counter(int fd, uint64_t& value) {
+  uint64_t data[3];
+  if (read(fd, data, sizeof(data)) != sizeof(data))
+    return false;
+  value = data[0];
+  if (data[2] && data[2] < data[1])
+    value = static_cast<uint64_t>(static_cast<double>(data[0]) * data[1] / data[2]);
+  return true;
+}
+
+uint64_t timeval_us(const struct timeval& tv) {
+  return static_cast<uint64_t>(tv.tv_sec) * 1000000 + tv.tv_usec;
+}
+
+}
+
+sebs::PerfCounters::PerfCounters() {
+  _hw_fds.fill(-1);
+  _sw_fds.fill(-1);
+
+  const uint64_t hw_configs[HW_COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+    PERF_COUNT_HW_BRANCH_MISSES
+  };
+  _hw_fds[0] = open_counter(PERF_TYPE_HARDWARE, hw_configs[0], -1);
+  if (_hw_fds[0] != -1) {
+    _hw_fds[1] = open_counter(PERF_TYPE_HARDWARE, hw_configs[1], _hw_fds[0]);
+    _hw_fds[2] = open_counter(PERF_TYPE_HW_CACHE, hw_configs[2], _hw_fds[0]);
+    _hw_fds[3] = open_counter(PERF_TYPE_HARDWARE, hw_configs[3], _hw_fds[0]);
+  }
+
+  // Software counters are opened individually: they often work in VMs without a PMU.
+  const uint64_t sw_configs[SW_COUNTERS] = {
+    PERF_COUNT_SW_CONTEXT_SWITCHES,
+    PERF_COUNT_SW_PAGE_FAULTS_MIN,
+    PERF_COUNT_SW_PAGE_FAULTS_MAJ
+  };
+  for (size_t i = 0; i < SW_COUNTERS; ++i)
+    _sw_fds[i] = open_counter(PERF_TYPE_SOFTWARE, sw_configs[i], -1);
+}
+
+sebs::PerfCounters::~PerfCounters() {
+  for (int fd : _hw_fds)
+    if (fd != -1)
+      close(fd);
+  for (int fd : _sw_fds)
+    if (fd != -1)
+      close(fd);
+}
+
+void sebs::PerfCounters::start() {
+  getrusage(RUSAGE_SELF, &_rusage_begin);
+
+  if (_hw_fds[0] != -1) {
+    ioctl(_hw_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(_hw_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+  for (int fd : _sw_fds) {
+    if (fd != -1) {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+}
+
+sebs::PerfSample sebs::PerfCounters::stop() {
+  if (_hw_fds[0] != -1)
+    ioctl(_hw_fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+  for (int fd : _sw_fds)
+    if (fd != -1)
+      ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+
+  struct rusage end;
+  getrusage(RUSAGE_SELF, &end);
+
+  PerfSample sample;
+  sample.source = "rusage";
+
+  uint64_t value;
+  for (size_t i = 0; i < HW_COUNTERS; ++i) {
+    if (_hw_fds[i] != -1 && read_counter(_hw_fds[i], value)) {
+      sample.counters.emplace_back(HW_NAMES[i], value);
+      sample.source = "perf_event";
+    }
+  }
+
+  const uint64_t rusage_values[SW_COUNTERS] = {
+    static_cast<uint64_t>((end.ru_nvcsw - _rusage_begin.ru_nvcsw) +
+                          (end.ru_nivcsw - _rusage_begin.ru_nivcsw)),
+    static_cast<uint64_t>(end.ru_minflt - _rusage_begin.ru_minflt),
+    static_cast<uint64_t>(end.ru_majflt - _rusage_begin.ru_majflt)
+  };
+  for (size_t i = 0; i < SW_COUNTERS; ++i) {
+    if (_sw_fds[i] != -1 && read_counter(_sw_fds[i], value)) {
+      sample.counters.emplace_back(SW_NAMES[i], value);
+      sample.source = "perf_event";
+    } else
+      sample.counters.emplace_back(SW_NAMES[i], rusage_values[i]);
+  }
+
+  // CPU time helps to tell throttling apart from blocking on I/O.
+  sample.counters.emplace_back("user_time", timeval_us(end.ru_utime) - timeval_us(_rusage_begin.ru_utime));
+  sample.counters.emplace_back("system_time", timeval_us(end.ru_stime) - timeval_us(_rusage_begin.ru_stime));
+
+  return sample;
+}
@@ -0,0 +1,55 @@
+// Copyright 2020-2025 ETH Zurich and the SeBS authors. All rights reserved.
+#ifndef PERF_COUNTERS_HPP
+#define PERF_COUNTERS_HPP
+
+#include <sys/resource.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace sebs {
+
+struct PerfSample {
+  // "perf_event" when counters come from the kernel, "rusage" on fallback.
+  const char* source = "rusage";
+  std::vector<std::pair<const char*, uint64_t>> counters;
+};
+
+/**
+ * Per-invocation hardware and software counters.
+ *
+ * Counters are opened once with perf_event_open and inherited by threads
+ * created afterwards. When the sandbox forbids the syscall (e.g., Lambda),
+ * context switches and page faults are taken from getrusage instead and
+ * hardware counters are omitted.
+ */
+class PerfCounters {
+public:
+  PerfCounters();
+  ~PerfCounters();
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  bool hardware_available() const { return _hw_fds[0] != -1; }
+
+  void start();
+  PerfSample stop();
+
+private:
+  static constexpr size_t HW_COUNTERS = 4;
+  static constexpr size_t SW_COUNTERS = 3;
+
+  // cycles (group leader), instructions, LLC misses, branch misses
+  std::array<int, HW_COUNTERS> _hw_fds;
+  // context switches, minor faults, major faults
+  std::array<int, SW_COUNTERS> _sw_fds;
+  struct rusage _rusage_begin;
+};
+
+};
+
+#endif
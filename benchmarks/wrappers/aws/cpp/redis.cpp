@@ -1,13 +1,14 @@
 // Copyright 2020-2025 ETH Zurich and the SeBS authors. All rights reserved.
 
-#include <chrono>
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <string>
-#include <thread>
-
-#include <aws/core/Aws.h>
 
 #include "redis.hpp"
+#include "retry.hpp"
 #include "utils.hpp"
 
 Redis::Redis(std::string redis_hostname, int redis_port) {
@@ -18,60 +19,155 @@ Redis::Redis(std::string redis_hostname, int redis_port) {
     } else {
       std::cerr << "Can't allocate redis context\n";
     }
+    return;
   }
+  // Detects connections dropped while the sandbox was frozen.
+  redisEnableKeepAlive(_context);
 }
 
-bool Redis::is_initialized() { return _context != nullptr; }
+Redis& Redis::get_client(std::string const &redis_hostname, int redis_port) {
+  static std::map<std::string, std::unique_ptr<Redis>> clients;
+  auto &client = clients[redis_hostname + ":" + std::to_string(redis_port)];
+  if (!client)
+    client.reset(new Redis(redis_hostname, redis_port));
+  return *client;
+}
 
-Redis::~Redis() { redisFree(_context); }
+// Errors reported while the server is loading data or busy are transient.
+static sebs::retry::Verdict classify_error(const char *error) {
+  for (const char *prefix : {"LOADING", "BUSY", "TRYAGAIN", "MASTERDOWN"})
+    if (std::strncmp(error, prefix, std::strlen(prefix)) == 0)
+      return sebs::retry::Verdict::RETRY;
+  std::cerr << "Redis Error: " << error << std::endl;
+  return sebs::retry::Verdict::FATAL;
+}
 
-uint64_t Redis::download_file(Aws::String const &key, int &required_retries,
-                              bool with_backoff) {
-  std::string comm = "GET " + key;
+bool Redis::is_initialized() { return _context != nullptr && !_context->err; }
 
-  auto bef = timeSinceEpochMicrosec();
-  int retries = 0;
-  const int MAX_RETRIES = 1500;
+Redis::~Redis() { redisFree(_context); }
 
-  while (retries < MAX_RETRIES) {
+redisReply *Redis::command(std::vector<std::string_view> const &args) {
+  if (_context == nullptr)
+    return nullptr;
 
-    redisReply *reply = (redisReply *)redisCommand(_context, comm.c_str());
+  std::vector<const char *> argv;
+  std::vector<size_t> argvlen;
+  argv.reserve(args.size());
+  argvlen.reserve(args.size());
+  for (auto &arg : args) {
+    argv.push_back(arg.data());
+    argvlen.push_back(arg.size());
+  }
 
-    if (reply->type == REDIS_REPLY_NIL || reply->type == REDIS_REPLY_ERROR) {
+  redisReply *reply = (redisReply *)redisCommandArgv(
+      _context, argv.size(), argv.data(), argvlen.data());
+  if (reply == nullptr) {
+    std::cerr << "Redis Error: " << _context->errstr << std::endl;
+    // After an I/O error the context cannot be used anymore.
+    if (redisReconnect(_context) != REDIS_OK)
+      return nullptr;
+    redisEnableKeepAlive(_context);
+    reply = (redisReply *)redisCommandArgv(
+        _context, argv.size(), argv.data(), argvlen.data());
+  }
+  return reply;
+}
 
-      retries += 1;
-      if (with_backoff) {
-        int sleep_time = retries;
-        if (retries > 100) {
-          sleep_time = retries * 2;
-        }
-        std::this_thread::sleep_for(std::chrono::milliseconds(sleep_time));
+// Sends `count` commands in windows of `depth` and passes each reply to `handle`.
+// As in command(), a connection lost while the sandbox was frozen is reopened
+// once; the commands are idempotent, so the pipeline restarts if no reply was read.
+template <typename Append, typename Handle>
+static bool pipeline(redisContext *context, size_t count, size_t depth,
+                     Append &&append, Handle &&handle) {
+  if (context == nullptr)
+    return false;
+  depth = std::max<size_t>(depth, 1);
+  bool received = false, reconnected = false;
+  for (size_t begin = 0; begin < count; ) {
+    size_t end = std::min(count, begin + depth);
+    bool failed = false;
+    for (size_t i = begin; i < end && !failed; ++i)
+      failed = append(i) != REDIS_OK;
+    // Replies of the whole window must be read, even after an error reply.
+    bool success = true;
+    for (size_t i = begin; i < end && !failed; ++i) {
+      redisReply *reply = nullptr;
+      if (redisGetReply(context, (void **)&reply) != REDIS_OK) {
+        failed = true;
+        break;
       }
+      received = true;
+      if (reply->type == REDIS_REPLY_ERROR) {
+        std::cerr << "Redis Error: " << reply->str << std::endl;
+        success = false;
+      } else if (success) {
+        handle(i, reply);
+      }
+      freeReplyObject(reply);
+    }
+    if (failed) {
+      std::cerr << "Redis Error: " << context->errstr << std::endl;
+      // After an I/O error the context cannot be used anymore.
+      if (received || reconnected || redisReconnect(context) != REDIS_OK)
+        return false;
+      redisEnableKeepAlive(context);
+      reconnected = true;
+      continue;
+    }
+    if (!success)
+      return false;
+    begin = end;
+  }
+  return true;
+}
 
-    } else {
+uint64_t Redis::download_file(std::string const &key, int &required_retries,
+                              bool with_backoff) {
+  return std::get<1>(download_file(key, _scratch, required_retries, with_backoff));
+}
 
-      uint64_t finishedTime = timeSinceEpochMicrosec();
-      required_retries = retries;
+std::tuple<std::string_view, uint64_t> Redis::download_file(
+    std::string const &key, std::vector<char> &buffer, int &required_retries,
+    bool with_backoff) {
+  sebs::retry::Policy policy;
+  if (!with_backoff)
+    policy.base_delay = 0;
 
-      freeReplyObject(reply);
-      return finishedTime - bef;
-    }
+  auto bef = timeSinceEpochMicrosec();
+  // A missing key (nil) is retried: it may not have been written yet.
+  bool success = sebs::retry::run(policy, [&]() {
+    redisReply *reply = command({"GET", key});
+    if (reply == nullptr)
+      return sebs::retry::Verdict::FATAL;
+    sebs::retry::Verdict verdict = sebs::retry::Verdict::SUCCESS;
+    if (reply->type == REDIS_REPLY_NIL)
+      verdict = sebs::retry::Verdict::RETRY;
+    else if (reply->type == REDIS_REPLY_ERROR)
+      verdict = classify_error(reply->str);
+    else
+      buffer.assign(reply->str, reply->str + reply->len);
     freeReplyObject(reply);
+    return verdict;
+  }, required_retries);
+
+  if (!success) {
+    buffer.clear();
+    return {std::string_view{}, 0};
   }
-  return 0;
+  uint64_t finishedTime = timeSinceEpochMicrosec();
+  return {std::string_view(buffer.data(), buffer.size()), finishedTime - bef};
 }
 
-uint64_t Redis::upload_file(Aws::String const &key, int size, char *pBuf) {
-  std::string comm = "SET " + key + " %b";
-
+uint64_t Redis::upload_file(std::string const &key, int size, char *pBuf) {
   uint64_t bef = timeSinceEpochMicrosec();
-  redisReply *reply =
-      (redisReply *)redisCommand(_context, comm.c_str(), pBuf, size);
+  redisReply *reply = command({"SET", key, std::string_view(pBuf, size)});
   uint64_t finishedTime = timeSinceEpochMicrosec();
 
-  if (reply->type == REDIS_REPLY_NIL || reply->type == REDIS_REPLY_ERROR) {
+  if (reply == nullptr || reply->type == REDIS_REPLY_ERROR) {
     std::cerr << "Failed to write in Redis!" << std::endl;
-    abort();
+    if (reply)
+      freeReplyObject(reply);
+    return 0;
   }
   freeReplyObject(reply);
 
@@ -79,17 +175,114 @@ uint64_t Redis::upload_file(Aws::String const &key, int size, char *pBuf) {
 }
 
 uint64_t Redis::delete_file(std::string const &key) {
-  std::string comm = "DEL " + key;
-
   uint64_t bef = timeSinceEpochMicrosec();
-  redisReply *reply = (redisReply *)redisCommand(_context, comm.c_str());
+  redisReply *reply = command({"DEL", key});
   uint64_t finishedTime = timeSinceEpochMicrosec();
 
-  if (reply->type == REDIS_REPLY_NIL || reply->type == REDIS_REPLY_ERROR) {
+  if (reply == nullptr || reply->type == REDIS_REPLY_ERROR) {
     std::cerr << "Couldn't delete the key!" << '\n';
-    abort();
+    if (reply)
+      freeReplyObject(reply);
+    return 0;
+  }
+  freeReplyObject(reply);
+
+  return finishedTime - bef;
+}
+
+uint64_t Redis::download_batch(std::vector<std::string> const &keys,
+                               std::vector<std::string> &values) {
+  values.assign(keys.size(), std::string());
+  std::vector<std::string_view> args{"MGET"};
+  args.insert(args.end(), keys.begin(), keys.end());
+
+  uint64_t bef = timeSinceEpochMicrosec();
+  redisReply *reply = command(args);
+  uint64_t finishedTime = timeSinceEpochMicrosec();
+
+  if (reply == nullptr || reply->type != REDIS_REPLY_ARRAY ||
+      reply->elements != keys.size()) {
+    std::cerr << "Redis Error: MGET failed" << std::endl;
+    if (reply)
+      freeReplyObject(reply);
+    return 0;
+  }
+  for (size_t i = 0; i < reply->elements; ++i) {
+    redisReply *element = reply->element[i];
+    if (element->type == REDIS_REPLY_STRING)
+      values[i].assign(element->str, element->len);
+  }
+  freeReplyObject(reply);
+
+  return finishedTime - bef;
+}
+
+uint64_t Redis::upload_batch(std::vector<std::string> const &keys,
+                             std::vector<std::string_view> const &values) {
+  if (keys.size() != values.size() || keys.empty()) {
+    std::cerr << "Error: upload_batch called with " << keys.size() << " keys and "
+              << values.size() << " values." << std::endl;
+    return 0;
+  }
+  std::vector<std::string_view> args{"MSET"};
+  args.reserve(1 + 2 * keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    args.push_back(keys[i]);
+    args.push_back(values[i]);
+  }
+
+  uint64_t bef = timeSinceEpochMicrosec();
+  redisReply *reply = command(args);
+  uint64_t finishedTime = timeSinceEpochMicrosec();
+
+  if (reply == nullptr || reply->type == REDIS_REPLY_ERROR) {
+    std::cerr << "Redis Error: MSET failed" << std::endl;
+    if (reply)
+      freeReplyObject(reply);
+    return 0;
   }
   freeReplyObject(reply);
 
   return finishedTime - bef;
 }
+
+uint64_t Redis::download_pipelined(std::vector<std::string> const &keys,
+                                   std::vector<std::string> &values,
+                                   size_t depth) {
+  values.assign(keys.size(), std::string());
+  uint64_t bef = timeSinceEpochMicrosec();
+  bool success = pipeline(_context, keys.size(), depth,
+    [&](size_t i) {
+      const char *argv[] = {"GET", keys[i].data()};
+      size_t argvlen[] = {3, keys[i].size()};
+      return redisAppendCommandArgv(_context, 2, argv, argvlen);
+    },
+    [&](size_t i, redisReply *reply) {
+      if (reply->type == REDIS_REPLY_STRING)
+        values[i].assign(reply->str, reply->len);
+    });
+  uint64_t finishedTime = timeSinceEpochMicrosec();
+
+  return success ? finishedTime - bef : 0;
+}
+
+uint64_t Redis::upload_pipelined(std::vector<std::string> const &keys,
+                                 std::vector<std::string_view> const &values,
+                                 size_t depth) {
+  if (keys.size() != values.size()) {
+    std::cerr << "Error: upload_pipelined called with " << keys.size() << " keys and "
+              << values.size() << " values." << std::endl;
+    return 0;
+  }
+  uint64_t bef = timeSinceEpochMicrosec();
+  bool success = pipeline(_context, keys.size(), depth,
+    [&](size_t i) {
+      const char *argv[] = {"SET", keys[i].data(), values[i].data()};
+      size_t argvlen[] = {3, keys[i].size(), values[i].size()};
+      return redisAppendCommandArgv(_context, 3, argv, argvlen);
+    },
+    [](size_t, redisReply *) {});
+  uint64_t finishedTime = timeSinceEpochMicrosec();
+
+  return success ? finishedTime - bef : 0;
+}
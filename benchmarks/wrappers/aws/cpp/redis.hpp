@@ -2,26 +2,77 @@
 
 #include <cstdint>
 #include <string>
-
-#include <aws/core/utils/memory/stl/AWSString.h>
+#include <string_view>
+#include <tuple>
+#include <vector>
 
 #include <hiredis/hiredis.h>
 
+/**
+ * Redis client for exchanging data between functions.
+ * All commands pass keys and values as binary-safe arguments.
+ */
 class Redis
 {
   redisContext* _context;
+  // Receives values discarded by download_file without a buffer.
+  std::vector<char> _scratch;
+
+  // Sends a command; a connection lost while the sandbox was frozen is reopened once.
+  redisReply* command(std::vector<std::string_view> const &args);
 public:
 
   Redis(std::string redis_hostname, int redis_port);
   ~Redis();
 
+  Redis(const Redis&) = delete;
+  Redis& operator=(const Redis&) = delete;
+
+  // Connection kept open across warm invocations, created on first use.
+  static Redis& get_client(std::string const &redis_hostname, int redis_port);
+
   bool is_initialized();
 
-  uint64_t download_file(Aws::String const &key, int &required_retries, bool with_backoff);
+  uint64_t download_file(std::string const &key, int &required_retries, bool with_backoff);
+
+  /*
+    * Reads the value of `key` into `buffer`, retrying until the key exists.
+    * @return A view of the value in `buffer` and the elapsed time in
+    * microseconds. On failure, an empty view and 0 are returned.
+  */
+  std::tuple<std::string_view, uint64_t> download_file(std::string const &key,
+                          std::vector<char> &buffer,
+                          int &required_retries,
+                          bool with_backoff);
 
-  uint64_t upload_file(Aws::String const &key, int size, char* pBuf);
+  uint64_t upload_file(std::string const &key, int size, char* pBuf);
 
   uint64_t delete_file(std::string const &key);
 
-};
+  /*
+    * Reads many keys with a single MGET.
+    * @param values Receives the value of each key, empty when the key does not exist.
+    * @return Elapsed time in microseconds, 0 on failure.
+  */
+  uint64_t download_batch(std::vector<std::string> const &keys,
+                          std::vector<std::string> &values);
+
+  // Writes many keys with a single MSET; returns the elapsed time in microseconds, 0 on failure.
+  uint64_t upload_batch(std::vector<std::string> const &keys,
+                          std::vector<std::string_view> const &values);
+
+  /*
+    * GET and SET sent with redisAppendCommandArgv in windows of `depth`
+    * commands, whose replies are read afterwards: one round trip per window.
+    * A stale connection is reopened once, before any reply has been read.
+    * @return Elapsed time in microseconds, 0 on failure.
+  */
+  uint64_t download_pipelined(std::vector<std::string> const &keys,
+                          std::vector<std::string> &values,
+                          size_t depth = 64);
 
+  uint64_t upload_pipelined(std::vector<std::string> const &keys,
+                          std::vector<std::string_view> const &values,
+                          size_t depth = 64);
+
+};
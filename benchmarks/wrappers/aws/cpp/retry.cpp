@@ -0,0 +1,80 @@
+// Copyright 2020-2025 ETH Zurich and the SeBS authors. All rights reserved.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+
+#include "retry.hpp"
+#include "utils.hpp"
+
+namespace sebs {
+namespace retry {
+
+static std::atomic<uint64_t> invocation_deadline{0};
+static std::atomic<uint64_t> attempts{0};
+static std::atomic<uint64_t> retries{0};
+static std::atomic<uint64_t> backoff_time{0};
+static std::atomic<uint64_t> fatal{0};
+static std::atomic<uint64_t> exhausted{0};
+
+void set_deadline(uint64_t deadline) {
+  invocation_deadline.store(deadline, std::memory_order_relaxed);
+}
+
+void reset() {
+  attempts.store(0, std::memory_order_relaxed);
+  retries.store(0, std::memory_order_relaxed);
+  backoff_time.store(0, std::memory_order_relaxed);
+  fatal.store(0, std::memory_order_relaxed);
+  exhausted.store(0, std::memory_order_relaxed);
+}
+
+Counters counters() {
+  return {
+    attempts.load(std::memory_order_relaxed),
+    retries.load(std::memory_order_relaxed),
+    backoff_time.load(std::memory_order_relaxed),
+    fatal.load(std::memory_order_relaxed),
+    exhausted.load(std::memory_order_relaxed)
+  };
+}
+
+namespace detail {
+
+void attempted(bool retry) {
+  attempts.fetch_add(1, std::memory_order_relaxed);
+  if (retry)
+    retries.fetch_add(1, std::memory_order_relaxed);
+}
+
+void abandoned(bool is_fatal) {
+  (is_fatal ? fatal : exhausted).fetch_add(1, std::memory_order_relaxed);
+}
+
+bool backoff(uint32_t retry, Policy const& policy) {
+  uint64_t delay = 0;
+  if (policy.base_delay > 0) {
+    // Cap the exponent so that the shift cannot overflow.
+    uint64_t ceiling = policy.base_delay << std::min<uint32_t>(retry, 20);
+    ceiling = std::min(ceiling, policy.max_delay);
+    thread_local std::minstd_rand generator{std::random_device{}()};
+    delay = std::uniform_int_distribution<uint64_t>(0, ceiling)(generator);
+  }
+
+  uint64_t deadline = invocation_deadline.load(std::memory_order_relaxed);
+  if (deadline > 0 && timeSinceEpochMicrosec() + delay + policy.deadline_margin >= deadline)
+    return false;
+
+  if (delay > 0) {
+    std::this_thread::sleep_for(std::chrono::microseconds(delay));
+    backoff_time.fetch_add(delay, std::memory_order_relaxed);
+  }
+  return true;
+}
+
+};
+
+};
+};
@@ -0,0 +1,89 @@
+// Copyright 2020-2025 ETH Zurich and the SeBS authors. All rights reserved.
+#ifndef RETRY_HPP
+#define RETRY_HPP
+
+#include <cstdint>
+
+namespace sebs {
+namespace retry {
+
+enum class Verdict { SUCCESS, RETRY, FATAL };
+
+struct Policy {
+  // Upper bound on attempts, including the first one.
+  uint32_t max_attempts = 1500;
+  // Delay before retry n is drawn uniformly from [0, min(max_delay, base_delay * 2^n)]
+  // microseconds ("full jitter"). Zero retries immediately, e.g., when polling for a key.
+  uint64_t base_delay = 1000;
+  uint64_t max_delay = 1000000;
+  // No retry is started later than this before the invocation deadline, in microseconds.
+  uint64_t deadline_margin = 200000;
+};
+
+struct Counters {
+  uint64_t attempts;
+  uint64_t retries;
+  // Time spent sleeping between attempts, in microseconds.
+  uint64_t backoff_time;
+  // Operations abandoned on a non-retryable error.
+  uint64_t fatal;
+  // Operations abandoned after running out of attempts or deadline budget.
+  uint64_t exhausted;
+};
+
+// Deadline of the current invocation in microseconds since epoch; 0 disables the budget.
+void set_deadline(uint64_t deadline);
+
+// Clears the counters; called by the handler before each invocation.
+void reset();
+
+// Counters accumulated since the last reset, across all threads.
+Counters counters();
+
+namespace detail {
+
+void attempted(bool retry);
+void abandoned(bool fatal);
+// Sleeps before retry `retry`; false if the deadline budget does not allow it.
+bool backoff(uint32_t retry, Policy const& policy);
+
+};
+
+/**
+ * Runs `attempt` until it returns SUCCESS or FATAL, the policy runs out of
+ * attempts, or the next backoff would cross the invocation deadline.
+ * @param retries Receives the number of retries performed.
+ * @return true on success.
+ */
+template<typename F>
+bool run(Policy const& policy, F && attempt, int& retries)
+{
+  for (uint32_t n = 0; ; ++n) {
+    detail::attempted(n > 0);
+    Verdict verdict = attempt();
+    retries = n;
+    if (verdict == Verdict::SUCCESS)
+      return true;
+    if (verdict == Verdict::FATAL) {
+      detail::abandoned(true);
+      return false;
+    }
+    if (n + 1 >= policy.max_attempts || !detail::backoff(n, policy)) {
+      detail::abandoned(false);
+      return false;
+    }
+  }
+}
+
+// For Aws::Client::AWSError: throttling, server-side and network errors are marked
+// as retryable by the SDK. Kept generic so that the handler builds without the SDK.
+template<typename Error>
+Verdict classify(Error const& error)
+{
+  return error.ShouldRetry() ? Verdict::RETRY : Verdict::FATAL;
+}
+
+};
+};
+
+#endif
@@ -0,0 +1,560 @@
+// Copyright 2020-2025 ETH Zurich and the SeBS authors. All rights reserved.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <aws/core/auth/AWSCredentialsProvider.h>
+#include <aws/core/client/ClientConfiguration.h>
+#include <aws/core/client/DefaultRetryStrategy.h>
+#include <aws/core/http/HttpResponse.h>
+#include <aws/core/http/HttpTypes.h>
+#include <aws/s3/S3ClientConfiguration.h>
+#include <aws/s3/model/AbortMultipartUploadRequest.h>
+#include <aws/s3/model/CompleteMultipartUploadRequest.h>
+#include <aws/s3/model/CompletedMultipartUpload.h>
+#include <aws/s3/model/CompletedPart.h>
+#include <aws/s3/model/CreateMultipartUploadRequest.h>
+#include <aws/s3/model/GetObjectRequest.h>
+#include <aws/s3/model/HeadBucketRequest.h>
+#include <aws/s3/model/HeadObjectRequest.h>
+#include <aws/s3/model/PutObjectRequest.h>
+#include <aws/s3/model/UploadPartRequest.h>
+
+#include <boost/interprocess/streams/bufferstream.hpp>
+
+#include "retry.hpp"
+#include "s3-storage.hpp"
+#include "utils.hpp"
+
+sebs::S3ClientOptions sebs::S3ClientOptions::from_env() {
+  S3ClientOptions options;
+  auto read = [](const char *name, long &value) {
+    const char *env = std::getenv(name);
+    if (env && *env)
+      value = std::strtol(env, nullptr, 10);
+  };
+  read("SEBS_S3_MAX_CONNECTIONS", options.max_connections);
+  read("SEBS_S3_CONNECT_TIMEOUT_MS", options.connect_timeout_ms);
+  read("SEBS_S3_REQUEST_TIMEOUT_MS", options.request_timeout_ms);
+  const char *keep_alive = std::getenv("SEBS_S3_TCP_KEEP_ALIVE");
+  if (keep_alive)
+    options.tcp_keep_alive = std::string(keep_alive) != "0";
+  const char *http_client = std::getenv("SEBS_S3_HTTP_CLIENT");
+  if (http_client)
+    options.http_client = http_client;
+  return options;
+}
+
+std::unique_ptr<sebs::S3Storage> sebs::S3Storage::create(
+    std::string const &endpoint, std::string const &access_key,
+    std::string const &secret_key, S3ClientOptions const &options) {
+  auto bef = timeSinceEpochMicrosec();
+  Aws::S3::S3ClientConfiguration config;
+  config.maxConnections = options.max_connections;
+  config.connectTimeoutMs = options.connect_timeout_ms;
+  config.requestTimeoutMs = options.request_timeout_ms;
+  config.enableTcpKeepAlive = options.tcp_keep_alive;
+  if (options.http_client == "curl")
+    config.httpLibOverride = Aws::Http::TransferLibType::CURL_CLIENT;
+  else if (!options.http_client.empty())
+    std::cerr << "Warning: unknown HTTP client " << options.http_client
+              << ", using the SDK default" << std::endl;
+
+  char const TAG[] = "LAMBDA_ALLOC";
+  std::shared_ptr<Aws::Auth::AWSCredentialsProvider> credentialsProvider;
+  if (endpoint.empty()) {
+    credentialsProvider = Aws::MakeShared<Aws::Auth::EnvironmentAWSCredentialsProvider>(TAG);
+  } else {
+    // S3-compatible services are addressed by path, as bucket subdomains do not resolve.
+    config.endpointOverride = endpoint;
+    config.scheme = Aws::Http::Scheme::HTTP;
+    config.useVirtualAddressing = false;
+    credentialsProvider = Aws::MakeShared<Aws::Auth::SimpleAWSCredentialsProvider>(
+      TAG, access_key, secret_key
+    );
+  }
+  Aws::S3::S3Client client(credentialsProvider, nullptr, config);
+  config.retryStrategy = Aws::MakeShared<Aws::Client::DefaultRetryStrategy>(TAG, 0);
+  Aws::S3::S3Client single_attempt_client(credentialsProvider, nullptr, config);
+  sebs::cold_start::record("storage_client", timeSinceEpochMicrosec() - bef);
+  return std::make_unique<S3Storage>(std::move(client), std::move(single_attempt_client),
+                                     std::max<long>(options.max_connections, 1));
+}
+
+uint64_t sebs::S3Storage::download_file(std::string const &bucket,
+                                std::string const &key, int &required_retries,
+                                bool report_dl_time,
+                                std::iostream &output_stream) {
+  sebs::trace::ScopedSpan span("storage.download");
+  Aws::S3::Model::GetObjectRequest request;
+  request.WithBucket(bucket).WithKey(key);
+  auto bef = timeSinceEpochMicrosec();
+
+  // A missing key is retried as well: the object may not have been written yet.
+  bool success = sebs::retry::run(sebs::retry::Policy{}, [&]() {
+    auto outcome = this->_single_attempt_client.GetObject(request);
+    if (outcome.IsSuccess()) {
+      output_stream.clear();
+      output_stream << outcome.GetResult().GetBody().rdbuf();
+      return sebs::retry::Verdict::SUCCESS;
+    }
+    if (outcome.GetError().GetErrorType() == Aws::S3::S3Errors::NO_SUCH_KEY)
+      return sebs::retry::Verdict::RETRY;
+    auto verdict = sebs::retry::classify(outcome.GetError());
+    if (verdict == sebs::retry::Verdict::FATAL)
+      std::cerr << "Error: GetObject: " << outcome.GetError().GetMessage()
+                << std::endl;
+    return verdict;
+  }, required_retries);
+  if (!success)
+    return 0;
+
+  uint64_t finishedTime = timeSinceEpochMicrosec();
+  return report_dl_time ? finishedTime - bef : finishedTime;
+}
+
+std::string sebs::S3Storage::object_etag(std::string const &bucket,
+                                        std::string const &key) {
+  sebs::trace::ScopedSpan span("storage.head");
+  Aws::S3::Model::HeadObjectRequest request;
+  request.WithBucket(bucket).WithKey(key);
+
+  std::string etag;
+  int retries = 0;
+  sebs::retry::run(sebs::retry::Policy{}, [&]() {
+    auto outcome = this->_single_attempt_client.HeadObject(request);
+    if (outcome.IsSuccess()) {
+      etag = outcome.GetResult().GetETag();
+      return sebs::retry::Verdict::SUCCESS;
+    }
+    auto verdict = sebs::retry::classify(outcome.GetError());
+    if (verdict == sebs::retry::Verdict::FATAL)
+      std::cerr << "Error: HeadObject: " << outcome.GetError().GetMessage()
+                << std::endl;
+    return verdict;
+  }, retries);
+  return etag;
+}
+
+uint64_t sebs::S3Storage::prewarm(std::string const &bucket, size_t connections) {
+  sebs::trace::ScopedSpan span("storage.prewarm");
+  auto bef = timeSinceEpochMicrosec();
+  // Requests beyond the pool size would wait for a connection instead of opening one.
+  connections = std::min(connections, _max_connections);
+  // Requests run concurrently, as sequential ones would reuse a single connection.
+  sebs::parallel_for(2 * connections, 2 * connections, [&](size_t idx) {
+    Aws::S3::Model::HeadBucketRequest request;
+    request.WithBucket(bucket);
+    auto &client = idx < connections ? this->_client : this->_single_attempt_client;
+    auto outcome = client.HeadBucket(request);
+    // Access errors still open a connection; only failing to connect is a problem.
+    if (!outcome.IsSuccess() &&
+        outcome.GetError().GetErrorType() == Aws::S3::S3Errors::NETWORK_CONNECTION)
+      std::cerr << "Warning: prewarm HeadBucket: " << outcome.GetError().GetMessage()
+                << std::endl;
+  });
+  return timeSinceEpochMicrosec() - bef;
+}
+
+std::tuple<std::string, uint64_t> sebs::S3Storage::download_file(
+    std::string const &bucket, std::string const &key) {
+  sebs::trace::ScopedSpan span("storage.download");
+  Aws::S3::Model::GetObjectRequest request;
+  request.WithBucket(bucket).WithKey(key);
+  auto bef = timeSinceEpochMicrosec();
+
+  Aws::S3::Model::GetObjectOutcome outcome = this->_client.GetObject(request);
+  if (!outcome.IsSuccess()) {
+    std::cerr << "Error: GetObject: " << outcome.GetError().GetMessage()
+              << std::endl;
+    return {"", 0};
+  }
+  auto &s = outcome.GetResult().GetBody();
+  uint64_t finishedTime = timeSinceEpochMicrosec();
+
+  std::string content((std::istreambuf_iterator<char>(s)),
+                      std::istreambuf_iterator<char>());
+  return {content, finishedTime - bef};
+}
+
+std::tuple<std::string_view, uint64_t> sebs::S3Storage::download_file(
+    std::string const &bucket, std::string const &key, std::vector<char> &buffer) {
+  sebs::trace::ScopedSpan span("storage.download");
+  BufferStreamBuf streambuf(buffer);
+
+  Aws::S3::Model::GetObjectRequest request;
+  request.WithBucket(bucket).WithKey(key);
+  request.SetResponseStreamFactory([&streambuf]() {
+    streambuf.reset();
+    return Aws::New<Aws::IOStream>("LAMBDA_ALLOC", &streambuf);
+  });
+  request.SetHeadersReceivedEventHandler(
+    [&buffer](const Aws::Http::HttpRequest *, Aws::Http::HttpResponse *response) {
+      if (response->HasHeader("content-length"))
+        buffer.reserve(std::stoull(response->GetHeader("content-length")));
+    }
+  );
+  auto bef = timeSinceEpochMicrosec();
+
+  Aws::S3::Model::GetObjectOutcome outcome = this->_client.GetObject(request);
+  if (!outcome.IsSuccess()) {
+    std::cerr << "Error: GetObject: " << outcome.GetError().GetMessage()
+              << std::endl;
+    buffer.clear();
+    return {std::string_view{}, 0};
+  }
+  uint64_t finishedTime = timeSinceEpochMicrosec();
+
+  return {std::string_view(buffer.data(), buffer.size()), finishedTime - bef};
+}
+
+std::tuple<std::string_view, uint64_t> sebs::S3Storage::download_file_parallel(
+    std::string const &bucket, std::string const &key, std::vector<char> &buffer,
+    TransferConfig const &config, std::vector<PartTiming> &parts) {
+  sebs::trace::ScopedSpan span("storage.download_parallel");
+  parts.clear();
+  size_t part_size = std::max<size_t>(config.part_size, 1);
+  auto bef = timeSinceEpochMicrosec();
+
+  // First part: learn the total size from Content-Range and reserve the buffer before the body arrives.
+  size_t total_size = 0;
+  {
+    BufferStreamBuf streambuf(buffer);
+    Aws::S3::Model::GetObjectRequest request;
+    request.WithBucket(bucket).WithKey(key).WithRange(
+      "bytes=0-" + std::to_string(part_size - 1)
+    );
+    request.SetResponseStreamFactory([&streambuf]() {
+      streambuf.reset();
+      return Aws::New<Aws::IOStream>("LAMBDA_ALLOC", &streambuf);
+    });
+    request.SetHeadersReceivedEventHandler(
+      [&buffer, &total_size](const Aws::Http::HttpRequest *, Aws::Http::HttpResponse *response) {
+        // Content-Range: bytes 0-8388607/104857600
+        if (!response->HasHeader("content-range"))
+          return;
+        const auto &range = response->GetHeader("content-range");
+        auto pos = range.find('/');
+        if (pos != Aws::String::npos && range[pos + 1] != '*') {
+          total_size = std::stoull(range.substr(pos + 1));
+          buffer.reserve(total_size);
+        }
+      }
+    );
+
+    auto part_bef = timeSinceEpochMicrosec();
+    auto outcome = this->_client.GetObject(request);
+    if (!outcome.IsSuccess()) {
+      // Ranged GET is rejected for empty objects; a plain GET handles them.
+      if (outcome.GetError().GetResponseCode() ==
+          Aws::Http::HttpResponseCode::REQUESTED_RANGE_NOT_SATISFIABLE) {
+        auto result = download_file(bucket, key, buffer);
+        parts.push_back({0, buffer.size(), std::get<1>(result)});
+        return result;
+      }
+      std::cerr << "Error: GetObject range 0: " << outcome.GetError().GetMessage()
+                << std::endl;
+      buffer.clear();
+      return {std::string_view{}, 0};
+    }
+    parts.push_back({0, buffer.size(), timeSinceEpochMicrosec() - part_bef});
+  }
+
+  if (total_size > buffer.size()) {
+    size_t first_part = buffer.size();
+    size_t remaining = (total_size - first_part + part_size - 1) / part_size;
+    buffer.resize(total_size);
+    parts.resize(remaining + 1);
+
+    int32_t parent = span.id();
+    std::atomic<bool> failed{false};
+    sebs::parallel_for(remaining, config.concurrency, [&](size_t idx) {
+      if (failed.load())
+        return;
+      sebs::trace::ScopedSpan part_span("storage.download_part", parent);
+      size_t offset = first_part + idx * part_size;
+      size_t size = std::min(part_size, total_size - offset);
+      RegionStreamBuf streambuf(buffer.data() + offset, size);
+
+      Aws::S3::Model::GetObjectRequest request;
+      request.WithBucket(bucket).WithKey(key).WithRange(
+        "bytes=" + std::to_string(offset) + "-" + std::to_string(offset + size - 1)
+      );
+      request.SetResponseStreamFactory([&streambuf]() {
+        streambuf.reset();
+        return Aws::New<Aws::IOStream>("LAMBDA_ALLOC", &streambuf);
+      });
+
+      auto part_bef = timeSinceEpochMicrosec();
+      auto outcome = this->_client.GetObject(request);
+      if (!outcome.IsSuccess() || streambuf.written() != size) {
+        std::cerr << "Error: GetObject range " << offset << ": "
+                  << (outcome.IsSuccess() ? "unexpected size" : outcome.GetError().GetMessage())
+                  << std::endl;
+        failed.store(true);
+        parts[idx + 1] = {offset, size, 0};
+        return;
+      }
+      parts[idx + 1] = {offset, size, timeSinceEpochMicrosec() - part_bef};
+    });
+
+    if (failed.load()) {
+      buffer.clear();
+      return {std::string_view{}, 0};
+    }
+  }
+  uint64_t finishedTime = timeSinceEpochMicrosec();
+
+  return {std::string_view(buffer.data(), buffer.size()), finishedTime - bef};
+}
+
+std::tuple<uint64_t, uint64_t> sebs::S3Storage::download_stream(
+    std::string const &bucket, std::string const &key,
+    std::function<void(std::istream&)> const &f) {
+  Aws::S3::Model::GetObjectRequest request;
+  request.WithBucket(bucket).WithKey(key);
+
+  auto bef = timeSinceEpochMicrosec();
+  Aws::S3::Model::GetObjectOutcome outcome;
+  {
+    sebs::trace::ScopedSpan span("storage.download");
+    outcome = this->_client.GetObject(request);
+  }
+  if (!outcome.IsSuccess()) {
+    std::cerr << "Error: GetObject: " << outcome.GetError().GetMessage() << std::endl;
+    return {0, 0};
+  }
+  uint64_t finished_download = timeSinceEpochMicrosec();
+
+  auto bef_compute = timeSinceEpochMicrosec();
+  {
+    sebs::trace::ScopedSpan span("storage.consume");
+    f(outcome.GetResult().GetBody());
+  }
+  uint64_t finished_compute = timeSinceEpochMicrosec();
+
+  return {finished_download - bef, finished_compute - bef_compute};
+}
+
+std::tuple<uint64_t, uint64_t> sebs::S3Storage::download_chunks(
+    std::string const &bucket, std::string const &key,
+    std::function<bool(std::string_view)> const &consume,
+    StreamConfig const &config) {
+  sebs::trace::ScopedSpan span("storage.download_chunks");
+  ChunkChannel channel(config.chunk_size, config.max_chunks);
+
+  Aws::S3::Model::GetObjectRequest request;
+  request.WithBucket(bucket).WithKey(key);
+  request.SetResponseStreamFactory([&channel]() {
+    return Aws::New<Aws::IOStream>("LAMBDA_ALLOC", &channel);
+  });
+  // Error responses are written to the same stream; keep them away from the consumer.
+  Aws::String etag;
+  request.SetHeadersReceivedEventHandler(
+    [&channel, &etag](const Aws::Http::HttpRequest *, Aws::Http::HttpResponse *response) {
+      bool error = static_cast<int>(response->GetResponseCode()) >= 300;
+      channel.set_discard(error);
+      if (!error && response->HasHeader("etag"))
+        etag = response->GetHeader("etag");
+    }
+  );
+  auto bef = timeSinceEpochMicrosec();
+
+  bool success = false;
+  int32_t parent = span.id();
+  std::thread transfer([&]() {
+    sebs::trace::ScopedSpan transfer_span("storage.transfer", parent);
+    // Chunks handed to the consumer cannot be taken back, so the SDK must not
+    // resend the body: each retry resumes after the last published byte.
+    int retries = 0;
+    success = sebs::retry::run(sebs::retry::Policy{}, [&]() {
+      size_t published = channel.rewind();
+      if (published > 0)
+        request.WithRange("bytes=" + std::to_string(published) + "-").WithIfMatch(etag);
+      auto outcome = this->_single_attempt_client.GetObject(request);
+      if (outcome.IsSuccess())
+        return sebs::retry::Verdict::SUCCESS;
+      if (channel.cancelled())
+        return sebs::retry::Verdict::FATAL;
+      // The previous attempt failed after the last byte.
+      if (published > 0 && outcome.GetError().GetResponseCode() ==
+          Aws::Http::HttpResponseCode::REQUESTED_RANGE_NOT_SATISFIABLE)
+        return sebs::retry::Verdict::SUCCESS;
+      auto verdict = sebs::retry::classify(outcome.GetError());
+      if (verdict == sebs::retry::Verdict::FATAL)
+        std::cerr << "Error: GetObject: " << outcome.GetError().GetMessage()
+                  << std::endl;
+      return verdict;
+    }, retries);
+    channel.finish();
+  });
+
+  uint64_t compute_time = 0;
+  bool stopped = false;
+  {
+    sebs::trace::ScopedSpan consume_span("storage.consume");
+    for (auto chunk = channel.next(); !chunk.empty(); chunk = channel.next()) {
+      auto bef_compute = timeSinceEpochMicrosec();
+      bool proceed = consume(chunk);
+      compute_time += timeSinceEpochMicrosec() - bef_compute;
+      if (!proceed) {
+        stopped = true;
+        channel.cancel();
+        break;
+      }
+    }
+  }
+  transfer.join();
+  uint64_t finishedTime = timeSinceEpochMicrosec();
+
+  if (!success && !stopped)
+    return {0, 0};
+  return {finishedTime - bef, compute_time};
+}
+
+uint64_t sebs::S3Storage::upload_random_file(std::string const &bucket,
+                                     std::string const &key, 
+                                     bool report_dl_time,
+                                     char * data,
+                                     size_t data_size) {
+  if (data == nullptr || data_size == 0) {
+    std::cerr << "Error: upload_random_file called with null data or zero size."
+              << std::endl;
+    return 0;
+  }
+  sebs::trace::ScopedSpan span("storage.upload");
+  /**
+   * We use Boost's bufferstream to wrap the array as an IOStream. Usign a
+   * light-weight streambuf wrapper, as many solutions (e.g.
+   * https://stackoverflow.com/questions/13059091/creating-an-input-stream-from-constant-memory)
+   * on the internet suggest does not work because the S3 SDK relies on proper
+   * functioning tellp(), etc... (for instance to get the body length).
+   */
+  const std::shared_ptr<Aws::IOStream> input_data =
+      std::make_shared<boost::interprocess::bufferstream>(
+          data, data_size);
+
+  Aws::S3::Model::PutObjectRequest request;
+  request.WithBucket(bucket).WithKey(key);
+  request.SetBody(input_data);
+  uint64_t bef_upload = timeSinceEpochMicrosec();
+  Aws::S3::Model::PutObjectOutcome outcome = this->_client.PutObject(request);
+  int64_t finishedTime = timeSinceEpochMicrosec();
+  if (!outcome.IsSuccess()) {
+    std::cerr << "Error: PutObject: " << outcome.GetError().GetMessage()
+              << std::endl;
+    return 0;
+  }
+  return report_dl_time ? finishedTime - bef_upload
+                 : finishedTime;
+}
+
+uint64_t sebs::S3Storage::upload_file_parallel(std::string const &bucket,
+                                       std::string const &key,
+                                       const char * data,
+                                       size_t data_size,
+                                       TransferConfig const &config,
+                                       std::vector<PartTiming> &parts) {
+  parts.clear();
+  if (data == nullptr || data_size == 0) {
+    std::cerr << "Error: upload_file_parallel called with null data or zero size."
+              << std::endl;
+    return 0;
+  }
+
+  // The SDK only reads from the body streams; bufferstream needs a non-const pointer.
+  char *begin = const_cast<char*>(data);
+  if (data_size < config.multipart_threshold) {
+    uint64_t time = upload_random_file(bucket, key, true, begin, data_size);
+    if (time > 0)
+      parts.push_back({0, data_size, time});
+    return time;
+  }
+
+  sebs::trace::ScopedSpan span("storage.upload_parallel");
+  // S3 requires parts of at least 5 MiB (except the last one) and at most 10000 parts.
+  const size_t MIN_PART_SIZE = 5 * 1024 * 1024;
+  const size_t MAX_PARTS = 10000;
+  size_t part_size = std::max(config.part_size, MIN_PART_SIZE);
+  part_size = std::max(part_size, (data_size + MAX_PARTS - 1) / MAX_PARTS);
+  size_t parts_count = (data_size + part_size - 1) / part_size;
+  auto bef = timeSinceEpochMicrosec();
+
+  Aws::S3::Model::CreateMultipartUploadRequest create_request;
+  create_request.WithBucket(bucket).WithKey(key);
+  auto create_outcome = this->_client.CreateMultipartUpload(create_request);
+  if (!create_outcome.IsSuccess()) {
+    std::cerr << "Error: CreateMultipartUpload: "
+              << create_outcome.GetError().GetMessage() << std::endl;
+    return 0;
+  }
+  const Aws::String upload_id = create_outcome.GetResult().GetUploadId();
+
+  std::vector<Aws::String> etags(parts_count);
+  parts.resize(parts_count);
+  int32_t parent = span.id();
+  std::atomic<bool> failed{false};
+  sebs::parallel_for(parts_count, config.concurrency, [&](size_t idx) {
+    if (failed.load())
+      return;
+    sebs::trace::ScopedSpan part_span("storage.upload_part", parent);
+    size_t offset = idx * part_size;
+    size_t size = std::min(part_size, data_size - offset);
+
+    Aws::S3::Model::UploadPartRequest request;
+    request.WithBucket(bucket).WithKey(key);
+    request.SetUploadId(upload_id);
+    // Part numbers are 1-based.
+    request.SetPartNumber(static_cast<int>(idx + 1));
+    request.SetContentLength(static_cast<long long>(size));
+    request.SetBody(
+      std::make_shared<boost::interprocess::bufferstream>(begin + offset, size)
+    );
+
+    auto part_bef = timeSinceEpochMicrosec();
+    auto outcome = this->_client.UploadPart(request);
+    if (!outcome.IsSuccess()) {
+      std::cerr << "Error: UploadPart " << idx + 1 << ": "
+                << outcome.GetError().GetMessage() << std::endl;
+      failed.store(true);
+      parts[idx] = {offset, size, 0};
+      return;
+    }
+    etags[idx] = outcome.GetResult().GetETag();
+    parts[idx] = {offset, size, timeSinceEpochMicrosec() - part_bef};
+  });
+
+  if (!failed.load()) {
+    Aws::S3::Model::CompletedMultipartUpload completed;
+    for (size_t idx = 0; idx < parts_count; ++idx)
+      completed.AddParts(
+        Aws::S3::Model::CompletedPart().WithETag(etags[idx]).WithPartNumber(static_cast<int>(idx + 1))
+      );
+
+    Aws::S3::Model::CompleteMultipartUploadRequest complete_request;
+    complete_request.WithBucket(bucket).WithKey(key);
+    complete_request.SetUploadId(upload_id);
+    complete_request.SetMultipartUpload(completed);
+    auto complete_outcome = this->_client.CompleteMultipartUpload(complete_request);
+    if (complete_outcome.IsSuccess())
+      return timeSinceEpochMicrosec() - bef;
+    std::cerr << "Error: CompleteMultipartUpload: "
+              << complete_outcome.GetError().GetMessage() << std::endl;
+  }
+
+  // Parts already stored are billed until the upload is aborted.
+  Aws::S3::Model::AbortMultipartUploadRequest abort_request;
+  abort_request.WithBucket(bucket).WithKey(key);
+  abort_request.SetUploadId(upload_id);
+  auto abort_outcome = this->_client.AbortMultipartUpload(abort_request);
+  if (!abort_outcome.IsSuccess())
+    std::cerr << "Error: AbortMultipartUpload: "
+              << abort_outcome.GetError().GetMessage() << std::endl;
+  return 0;
+}
@@ -0,0 +1,116 @@
+// Copyright 2020-2025 ETH Zurich and the SeBS authors. All rights reserved.
+#ifndef S3_STORAGE_HPP
+#define S3_STORAGE_HPP
+
+#include <memory>
+
+#include <aws/core/utils/memory/stl/AWSString.h>
+#include <aws/s3/S3Client.h>
+
+#include "storage.hpp"
+
+namespace sebs {
+
+struct S3ClientOptions {
+  // Defaults match the SDK defaults.
+  long max_connections = 25;
+  long connect_timeout_ms = 1000;
+  long request_timeout_ms = 3000;
+  bool tcp_keep_alive = true;
+  // "curl" forces the libcurl client; empty keeps the SDK default.
+  std::string http_client;
+
+  // Reads SEBS_S3_MAX_CONNECTIONS, SEBS_S3_CONNECT_TIMEOUT_MS,
+  // SEBS_S3_REQUEST_TIMEOUT_MS, SEBS_S3_TCP_KEEP_ALIVE and SEBS_S3_HTTP_CLIENT.
+  static S3ClientOptions from_env();
+};
+
+class S3Storage : public Storage
+{
+public:
+  Aws::S3::S3Client _client;
+  // Same configuration without SDK retries, for requests retried by sebs::retry,
+  // so that every attempt is counted and bounded by the invocation deadline.
+  Aws::S3::S3Client _single_attempt_client;
+
+  // Connections in the pool of each client.
+  size_t _max_connections;
+
+  S3Storage(Aws::S3::S3Client && client, Aws::S3::S3Client && single_attempt_client,
+            size_t max_connections):
+    _client(client),
+    _single_attempt_client(single_attempt_client),
+    _max_connections(max_connections)
+  {}
+
+  /*
+    * Creates a client for AWS S3 or, when `endpoint` is not empty, for an
+    * S3-compatible service such as MinIO, e.g., "localhost:9000".
+    * Without an endpoint, credentials are taken from the environment.
+  */
+  static std::unique_ptr<S3Storage> create(std::string const &endpoint = "",
+                          std::string const &access_key = "",
+                          std::string const &secret_key = "",
+                          S3ClientOptions const &options = S3ClientOptions::from_env());
+
+  std::string object_etag(std::string const &bucket,
+                          std::string const &key) override;
+
+  // Concurrent HeadBucket requests on both clients; any response, including an error,
+  // leaves a pooled connection. At most `_max_connections` per client are opened.
+  uint64_t prewarm(std::string const &bucket, size_t connections) override;
+
+  uint64_t download_file(std::string const &bucket,
+                          std::string const &key,
+                          int &required_retries,
+                          bool report_dl_time,
+                          std::iostream &output_stream) override;
+
+  std::tuple<std::string, uint64_t> download_file(std::string const &bucket,
+                          std::string const &key) override;
+
+  // The buffer is reserved from the Content-Length header before the body arrives.
+  std::tuple<std::string_view, uint64_t> download_file(std::string const &bucket,
+                          std::string const &key,
+                          std::vector<char> &buffer) override;
+
+  /*
+    * Concurrent ranged GETs written in place into `buffer`. The first part
+    * also returns the object size (Content-Range), so no additional HEAD
+    * request is needed.
+  */
+  std::tuple<std::string_view, uint64_t> download_file_parallel(std::string const &bucket,
+                          std::string const &key,
+                          std::vector<char> &buffer,
+                          TransferConfig const &config,
+                          std::vector<PartTiming> &parts) override;
+
+  std::tuple<uint64_t, uint64_t> download_stream(std::string const &bucket,
+                          std::string const &key,
+                          std::function<void(std::istream&)> const &f) override;
+
+  // The transfer runs on a separate thread and pauses while `config.max_chunks` chunks are waiting.
+  // A failed transfer resumes with a ranged GET after the last chunk handed to the consumer.
+  std::tuple<uint64_t, uint64_t> download_chunks(std::string const &bucket,
+                          std::string const &key,
+                          std::function<bool(std::string_view)> const &consume,
+                          StreamConfig const &config = StreamConfig{}) override;
+
+  uint64_t upload_random_file(std::string const &bucket,
+                          std::string const &key,
+                          bool report_dl_time,
+                          char * data,
+                          size_t data_size) override;
+
+  // Multipart upload; a failed part aborts the whole upload, so no orphaned parts are left.
+  uint64_t upload_file_parallel(std::string const &bucket,
+                          std::string const &key,
+                          const char * data,
+                          size_t data_size,
+                          TransferConfig const &config,
+                          std::vector<PartTiming> &parts) override;
+};
+
+};
+
+#endif
@@ -1,118 +1,133 @@
 // Copyright 2020-2025 ETH Zurich and the SeBS authors. All rights reserved.
 
+#include <algorithm>
+#include <cstdlib>
 #include <memory>
-#include <iostream>
-#include <sstream>
-
-#include <aws/core/auth/AWSCredentialsProvider.h>
-#include <aws/core/client/ClientConfiguration.h>
-#include <aws/s3/model/GetObjectRequest.h>
-#include <aws/s3/model/PutObjectRequest.h>
-
-#include <boost/interprocess/streams/bufferstream.hpp>
+#include <string>
 
+#include "local-storage.hpp"
+#ifdef SEBS_USE_AWS_SDK
+#include "s3-storage.hpp"
+#endif
 #include "storage.hpp"
-#include "utils.hpp"
-
-sebs::Storage sebs::Storage::get_client() {
-  Aws::Client::ClientConfiguration config;
 
-  char const TAG[] = "LAMBDA_ALLOC";
-  auto credentialsProvider = Aws::MakeShared<Aws::Auth::EnvironmentAWSCredentialsProvider>(TAG);
-  Aws::S3::S3Client client(credentialsProvider, nullptr, config);
-  return Storage(std::move(client));
+sebs::ChunkChannel::ChunkChannel(size_t chunk_size, size_t max_chunks):
+  _chunks(std::max<size_t>(max_chunks, 1) + 1),
+  _current(0),
+  _consumed(_chunks.size())
+{
+  // One extra chunk is filled by the producer while the others are queued.
+  for (size_t idx = 0; idx < _chunks.size(); ++idx) {
+    _chunks[idx].resize(std::max<size_t>(chunk_size, 1));
+    if (idx != _current)
+      _free.push_back(idx);
+  }
+  setp(_chunks[_current].data(), _chunks[_current].data() + _chunks[_current].size());
 }
 
-uint64_t sebs::Storage::download_file(Aws::String const &bucket,
-                                Aws::String const &key, int &required_retries,
-                                bool report_dl_time,
-                                Aws::IOStream &output_stream) {
-  Aws::S3::Model::GetObjectRequest request;
-  request.WithBucket(bucket).WithKey(key);
-  auto bef = timeSinceEpochMicrosec();
+bool sebs::ChunkChannel::publish() {
+  size_t size = pptr() - pbase();
+  std::unique_lock<std::mutex> lock(_mutex);
+  if (_cancelled)
+    return false;
+  if (_discard || size == 0) {
+    setp(pbase(), epptr());
+    return true;
+  }
+  _ready.emplace_back(_current, size);
+  _published += size;
+  _cv.notify_all();
 
-  int retries = 0;
-  // const int MAX_RETRIES = 500;
-  const int MAX_RETRIES = 1500;
-  while (retries < MAX_RETRIES) {
-    auto outcome = this->_client.GetObject(request);
-    if (outcome.IsSuccess()) {
-      auto &s = outcome.GetResult().GetBody();
-      uint64_t finishedTime = timeSinceEpochMicrosec();
+  // Backpressure: wait until the consumer returns a chunk.
+  _cv.wait(lock, [this]() { return !_free.empty() || _cancelled; });
+  if (_cancelled) {
+    setp(pbase(), pbase());
+    return false;
+  }
+  _current = _free.back();
+  _free.pop_back();
+  setp(_chunks[_current].data(), _chunks[_current].data() + _chunks[_current].size());
+  return true;
+}
 
-      output_stream.clear();
-      output_stream << s.rdbuf();
+sebs::ChunkChannel::int_type sebs::ChunkChannel::overflow(int_type ch) {
+  if (!publish())
+    return traits_type::eof();
+  if (!traits_type::eq_int_type(ch, traits_type::eof()))
+    sputc(traits_type::to_char_type(ch));
+  return traits_type::not_eof(ch);
+}
 
-      required_retries = retries;
-      if (report_dl_time) {
-        return finishedTime - bef;
-      } else {
-        return finishedTime;
-      }
-    } else {
-      retries += 1;
-      // int sleep_time = retries;
-      // if (retries > 100) {
-      //     sleep_time = retries * 2;
-      // }
-      // std::this_thread::sleep_for(std::chrono::milliseconds(sleep_time));
-    }
+void sebs::ChunkChannel::finish() {
+  size_t size = pptr() - pbase();
+  std::unique_lock<std::mutex> lock(_mutex);
+  if (size > 0 && !_discard && !_cancelled) {
+    _ready.emplace_back(_current, size);
+    _published += size;
   }
-  return 0;
+  setp(pbase(), pbase());
+  _finished = true;
+  _cv.notify_all();
 }
 
-std::tuple<std::string, uint64_t> sebs::Storage::download_file(
-    Aws::String const &bucket, Aws::String const &key) {
-  Aws::S3::Model::GetObjectRequest request;
-  request.WithBucket(bucket).WithKey(key);
-  auto bef = timeSinceEpochMicrosec();
+void sebs::ChunkChannel::set_discard(bool discard) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _discard = discard;
+}
 
-  Aws::S3::Model::GetObjectOutcome outcome = this->_client.GetObject(request);
-  if (!outcome.IsSuccess()) {
-    std::cerr << "Error: GetObject: " << outcome.GetError().GetMessage()
-              << std::endl;
-    return {"", 0};
-  }
-  auto &s = outcome.GetResult().GetBody();
-  uint64_t finishedTime = timeSinceEpochMicrosec();
+size_t sebs::ChunkChannel::rewind() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  if (!_cancelled)
+    setp(pbase(), epptr());
+  return _published;
+}
 
-  std::string content((std::istreambuf_iterator<char>(s)),
-                      std::istreambuf_iterator<char>());
-  return {content, finishedTime - bef};
+bool sebs::ChunkChannel::cancelled() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  return _cancelled;
 }
 
-uint64_t sebs::Storage::upload_random_file(Aws::String const &bucket,
-                                     Aws::String const &key, 
-                                     bool report_dl_time,
-                                     char * data,
-                                     size_t data_size) {
-  if (data == nullptr || data_size == 0) {
-    std::cerr << "Error: upload_random_file called with null data or zero size."
-              << std::endl;
-    return 0;
-  }
-  /**
-   * We use Boost's bufferstream to wrap the array as an IOStream. Usign a
-   * light-weight streambuf wrapper, as many solutions (e.g.
-   * https://stackoverflow.com/questions/13059091/creating-an-input-stream-from-constant-memory)
-   * on the internet suggest does not work because the S3 SDK relies on proper
-   * functioning tellp(), etc... (for instance to get the body length).
-   */
-  const std::shared_ptr<Aws::IOStream> input_data =
-      std::make_shared<boost::interprocess::bufferstream>(
-          data, data_size);
+void sebs::ChunkChannel::cancel() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _cancelled = true;
+  _cv.notify_all();
+}
 
-  Aws::S3::Model::PutObjectRequest request;
-  request.WithBucket(bucket).WithKey(key);
-  request.SetBody(input_data);
-  uint64_t bef_upload = timeSinceEpochMicrosec();
-  Aws::S3::Model::PutObjectOutcome outcome = this->_client.PutObject(request);
-  int64_t finishedTime = timeSinceEpochMicrosec();
-  if (!outcome.IsSuccess()) {
-    std::cerr << "Error: PutObject: " << outcome.GetError().GetMessage()
-              << std::endl;
-    return 0;
+std::string_view sebs::ChunkChannel::next() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  if (_consumed < _chunks.size()) {
+    _free.push_back(_consumed);
+    _consumed = _chunks.size();
+    _cv.notify_all();
   }
-  return report_dl_time ? finishedTime - bef_upload
-                 : finishedTime;
+  _cv.wait(lock, [this]() { return !_ready.empty() || _finished || _cancelled; });
+  if (_ready.empty() || _cancelled)
+    return std::string_view{};
+
+  auto [idx, size] = _ready.front();
+  _ready.pop_front();
+  _consumed = idx;
+  return std::string_view(_chunks[idx].data(), size);
+}
+
+sebs::Storage& sebs::Storage::get_client() {
+  static std::unique_ptr<Storage> client = []() -> std::unique_ptr<Storage> {
+    const char *local_dir = std::getenv("SEBS_STORAGE_DIR");
+    if (local_dir)
+      return std::make_unique<LocalStorage>(local_dir);
+#ifdef SEBS_USE_AWS_SDK
+    const char *minio_address = std::getenv("MINIO_ADDRESS");
+    if (minio_address) {
+      const char *access_key = std::getenv("MINIO_ACCESS_KEY");
+      const char *secret_key = std::getenv("MINIO_SECRET_KEY");
+      return S3Storage::create(minio_address, access_key ? access_key : "",
+                               secret_key ? secret_key : "");
+    }
+    return S3Storage::create();
+#else
+    // Without the AWS SDK, objects can only come from the local filesystem.
+    return std::make_unique<LocalStorage>(".");
+#endif
+  }();
+  return *client;
 }
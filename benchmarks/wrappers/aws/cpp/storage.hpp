@@ -1,74 +1,293 @@
 // Copyright 2020-2025 ETH Zurich and the SeBS authors. All rights reserved.
+#ifndef STORAGE_HPP
+#define STORAGE_HPP
 
+#include <condition_variable>
 #include <cstdint>
-
-#include <aws/core/utils/memory/stl/AWSString.h>
-#include <aws/s3/S3Client.h>
-#include <aws/s3/model/GetObjectRequest.h>
+#include <deque>
+#include <functional>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
 
 #include "utils.hpp"
 
 namespace sebs {
 
-class Storage
+/**
+ * Output streambuf appending to a caller's vector. Used as the response stream
+ * so that an object is written once, directly into a reusable buffer.
+ * The SDK requests a new stream for every attempt: call reset() in the
+ * stream factory so that a retry does not append to a failed attempt.
+ */
+class BufferStreamBuf : public std::streambuf
+{
+public:
+  explicit BufferStreamBuf(std::vector<char>& buffer):
+    _buffer(buffer)
+  {
+    _buffer.clear();
+  }
+
+  void reset() { _buffer.clear(); }
+
+protected:
+  std::streamsize xsputn(const char* s, std::streamsize n) override
+  {
+    _buffer.insert(_buffer.end(), s, s + n);
+    return n;
+  }
+
+  int_type overflow(int_type ch) override
+  {
+    if (!traits_type::eq_int_type(ch, traits_type::eof()))
+      _buffer.push_back(traits_type::to_char_type(ch));
+    return traits_type::not_eof(ch);
+  }
+
+private:
+  std::vector<char>& _buffer;
+};
+
+/**
+ * Output streambuf writing into a fixed memory region, used for ranged
+ * GETs that fill disjoint parts of one buffer concurrently.
+ * Writing past the region fails the stream, which aborts the transfer.
+ */
+class RegionStreamBuf : public std::streambuf
+{
+public:
+  RegionStreamBuf(char* begin, size_t size)
+  {
+    setp(begin, begin + size);
+  }
+
+  // Rewinds to the start of the region, for a retried attempt.
+  void reset() { setp(pbase(), epptr()); }
+
+  size_t written() const { return pptr() - pbase(); }
+};
+
+/**
+ * Bounded channel of fixed-size chunks between the SDK thread receiving a
+ * response body and the thread consuming it. Used as the GetObject response
+ * streambuf: the producer blocks when all chunks are full (backpressure),
+ * the consumer blocks until the next chunk is ready.
+ */
+class ChunkChannel : public std::streambuf
 {
 public:
-  Aws::S3::S3Client _client;
+  ChunkChannel(size_t chunk_size, size_t max_chunks);
+
+  // Consumer: waits for the next chunk, returning the previous one to the pool.
+  // The view is valid until the next call; an empty view marks the end of stream.
+  std::string_view next();
+
+  // Consumer: stops the transfer; further writes fail and abort the request.
+  void cancel();
+
+  // Producer: publishes the partially filled chunk and marks the end of stream.
+  void finish();
+
+  // Producer: drops everything written from now on, e.g., an error response body.
+  // Set for every response, as a retried request may succeed after an error.
+  void set_discard(bool discard);
+
+  // Producer: drops the unpublished rest of a failed response and returns the
+  // number of bytes published so far, from which a retry resumes.
+  size_t rewind();
+
+  bool cancelled();
+
+protected:
+  int_type overflow(int_type ch) override;
+
+private:
+  // Queues the current chunk and waits for a free one; false when cancelled.
+  bool publish();
+
+  std::vector<std::vector<char>> _chunks;
+  std::vector<size_t> _free;
+  std::deque<std::pair<size_t, size_t>> _ready;
+  size_t _current;
+  size_t _consumed;
+  size_t _published = 0;
+  bool _finished = false;
+  bool _cancelled = false;
+  bool _discard = false;
+  std::mutex _mutex;
+  std::condition_variable _cv;
+};
+
+struct StreamConfig {
+  // Size of a chunk handed to the consumer, in bytes; the last one may be smaller.
+  size_t chunk_size = 1024 * 1024;
+  // Chunks received but not yet consumed before the transfer is paused.
+  size_t max_chunks = 4;
+};
+
+struct TransferConfig {
+  // Size of a single ranged GET or multipart upload part, in bytes.
+  size_t part_size = 8 * 1024 * 1024;
+  // Maximum number of parts in flight.
+  size_t concurrency = 8;
+  // Uploads below this size use a single PutObject.
+  size_t multipart_threshold = 16 * 1024 * 1024;
+};
 
-  Storage(Aws::S3::S3Client && client):
-    _client(client)
-  {}
+struct PartTiming {
+  size_t offset;
+  size_t size;
+  // Elapsed time in microseconds; 0 when the part failed.
+  uint64_t time;
+};
+
+/**
+ * Object storage interface of C++ benchmarks.
+ *
+ * Backends: S3Storage (AWS S3 or an S3-compatible endpoint such as MinIO) and
+ * LocalStorage (a directory on the local filesystem, files are mmap-ed).
+ * Benchmarks use the instance selected by get_client().
+ */
+class Storage
+{
+public:
+  virtual ~Storage() = default;
 
-  static Storage get_client();
+  /*
+    * Returns the process-wide storage client, created on first use:
+    * - SEBS_STORAGE_DIR set: LocalStorage serving <dir>/<bucket>/<key>.
+    * - MINIO_ADDRESS set: S3Storage with endpoint override and path-style
+    *   addressing, credentials from MINIO_ACCESS_KEY/MINIO_SECRET_KEY.
+    * - Otherwise: S3Storage for AWS S3.
+  */
+  static Storage& get_client();
 
-  uint64_t download_file(Aws::String const &bucket,
-                          Aws::String const &key,
+  /*
+    * Downloads an object into `output_stream`, retrying until it exists.
+    * @return Elapsed time in microseconds if `report_dl_time`, otherwise
+    * the completion timestamp; 0 on failure.
+  */
+  virtual uint64_t download_file(std::string const &bucket,
+                          std::string const &key,
                           int &required_retries,
                           bool report_dl_time,
-                          Aws::IOStream &output_stream);
+                          std::iostream &output_stream) = 0;
 
   /*
-    * Downloads a file from S3
-    * @param bucket The S3 bucket name
-    * @param key The S3 object key
+    * Downloads an object.
+    * @param bucket The bucket name
+    * @param key The object key
     * @return A tuple containing the file content as a string and the elapsed
     * time in microseconds.
     * If the download fails, an empty string and 0 are returned.
   */
-  std::tuple<std::string, uint64_t> download_file(Aws::String const &bucket,
-                          Aws::String const &key);
+  virtual std::tuple<std::string, uint64_t> download_file(std::string const &bucket,
+                          std::string const &key) = 0;
 
+  /*
+    * Downloads an object without allocating a new buffer per call.
+    * The view points into `buffer` and stays valid until the buffer is modified,
+    * e.g., by the next call with the same `buffer` or release().
+    * @return A non-owning view of the object and the elapsed time in
+    * microseconds. On failure, an empty view and 0 are returned.
+  */
+  virtual std::tuple<std::string_view, uint64_t> download_file(std::string const &bucket,
+                          std::string const &key,
+                          std::vector<char> &buffer) = 0;
 
-  template<typename F>
-  std::tuple<uint64_t, uint64_t> download_stream(
-      Aws::String const &bucket, Aws::String const &key, F && f
-  )
-  {
-    Aws::S3::Model::GetObjectRequest request;
-    request.WithBucket(bucket).WithKey(key);
-
-    auto bef = timeSinceEpochMicrosec();
-    Aws::S3::Model::GetObjectOutcome outcome = this->_client.GetObject(request);
-    if (!outcome.IsSuccess()) {
-      std::cerr << "Error: GetObject: " << outcome.GetError().GetMessage() << std::endl;
-      return {0, 0};
-    }
-    uint64_t finished_download = timeSinceEpochMicrosec();
-
-    auto bef_compute = timeSinceEpochMicrosec();
-    f(outcome.GetResult().GetBody());
-    uint64_t finished_compute = timeSinceEpochMicrosec();
-
-    return {finished_download - bef, finished_compute - bef_compute};
-  }
+  /*
+    * Downloads an object in parts, fetched on at most `config.concurrency`
+    * threads. Same view semantics as download_file with a buffer.
+    * @param parts Receives offset, size and time of each part.
+  */
+  virtual std::tuple<std::string_view, uint64_t> download_file_parallel(std::string const &bucket,
+                          std::string const &key,
+                          std::vector<char> &buffer,
+                          TransferConfig const &config,
+                          std::vector<PartTiming> &parts) = 0;
+
+  /*
+    * Downloads an object and passes it to `f` as an input stream.
+    * @return Download and processing time in microseconds; 0 and 0 on failure.
+  */
+  virtual std::tuple<uint64_t, uint64_t> download_stream(std::string const &bucket,
+                          std::string const &key,
+                          std::function<void(std::istream&)> const &f) = 0;
+
+  /*
+    * Passes an object to `consume` in chunks of `config.chunk_size` bytes as
+    * they become available, so that processing overlaps with the transfer.
+    * `consume` returns false to stop the download early.
+    * @return Elapsed time of the whole download and the time spent in
+    * `consume`, in microseconds. On failure, 0 and 0 are returned; stopping
+    * early is not a failure.
+  */
+  virtual std::tuple<uint64_t, uint64_t> download_chunks(std::string const &bucket,
+                          std::string const &key,
+                          std::function<bool(std::string_view)> const &consume,
+                          StreamConfig const &config = StreamConfig{}) = 0;
 
-  uint64_t upload_random_file(Aws::String const &bucket,
-                          Aws::String const &key,
+  /*
+    * Uploads `data_size` bytes from `data`.
+    * @return Elapsed time in microseconds if `report_dl_time`, otherwise
+    * the completion timestamp; 0 on failure.
+  */
+  virtual uint64_t upload_random_file(std::string const &bucket,
+                          std::string const &key,
                           bool report_dl_time,
                           char * data,
-                          size_t data_size);
+                          size_t data_size) = 0;
+
+  /*
+    * Uploads a buffer in parts, sent on at most `config.concurrency` threads
+    * without copying. Buffers below `config.multipart_threshold` are uploaded
+    * at once.
+    * @param parts Receives offset, size and time of each part.
+    * @return Elapsed time in microseconds, 0 on failure.
+  */
+  virtual uint64_t upload_file_parallel(std::string const &bucket,
+                          std::string const &key,
+                          const char * data,
+                          size_t data_size,
+                          TransferConfig const &config,
+                          std::vector<PartTiming> &parts) = 0;
+
+  /*
+    * Returns an identifier of the current version of an object (the ETag
+    * on S3) without downloading it, e.g., to validate a local copy.
+    * @return The identifier; empty on failure.
+  */
+  virtual std::string object_etag(std::string const &bucket,
+                          std::string const &key) = 0;
 
+  /*
+    * Opens up to `connections` pooled connections to the endpoint of `bucket`,
+    * so that later requests skip DNS and TCP/TLS handshakes.
+    * @return Elapsed time in microseconds; backends without connections do nothing.
+  */
+  virtual uint64_t prewarm(std::string const &bucket, size_t connections)
+  {
+    (void)bucket;
+    (void)connections;
+    return 0;
+  }
+
+  /*
+    * Ends the view returned for `buffer` and frees the buffer's capacity.
+    * For objects used only once.
+  */
+  virtual void release(std::vector<char> &buffer)
+  {
+    std::vector<char>().swap(buffer);
+  }
 };
 
 };
 
+#endif
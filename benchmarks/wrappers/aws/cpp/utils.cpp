@@ -1,6 +1,14 @@
 // Copyright 2020-2025 ETH Zurich and the SeBS authors. All rights reserved.
 
+#include <sched.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
 #include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
 
 #include "utils.hpp"
 
@@ -9,3 +17,160 @@ uint64_t timeSinceEpochMicrosec() {
   auto time = now.time_since_epoch();
   return std::chrono::duration_cast<std::chrono::microseconds>(time).count();
 }
+
+uint64_t timeMonotonicNanosec() {
+  auto now = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+}
+
+namespace sebs {
+
+// CPU limit of the cgroup, rounded up: cgroup v2 cpu.max, or v1 CFS quota and period. 0 if unlimited.
+static size_t cgroup_cpu_limit() {
+  long long quota = -1, period = 0;
+  std::ifstream cpu_max("/sys/fs/cgroup/cpu.max");
+  std::string quota_str;
+  if (cpu_max >> quota_str >> period) {
+    if (quota_str != "max")
+      quota = std::stoll(quota_str);
+  } else {
+    std::ifstream quota_file("/sys/fs/cgroup/cpu/cpu.cfs_quota_us");
+    std::ifstream period_file("/sys/fs/cgroup/cpu/cpu.cfs_period_us");
+    if (!(quota_file >> quota) || !(period_file >> period))
+      quota = -1;
+  }
+  if (quota <= 0 || period <= 0)
+    return 0;
+  return static_cast<size_t>((quota + period - 1) / period);
+}
+
+size_t available_cpus() {
+  size_t cpus = std::max(std::thread::hardware_concurrency(), 1u);
+  cpu_set_t set;
+  if (sched_getaffinity(0, sizeof(set), &set) == 0 && CPU_COUNT(&set) > 0)
+    cpus = CPU_COUNT(&set);
+
+  size_t limit = cgroup_cpu_limit();
+  return limit ? std::min(cpus, limit) : cpus;
+}
+
+namespace memory {
+
+bool reset_peak_rss() {
+  // Writing 5 to clear_refs resets VmHWM (Linux 4.0+).
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  return static_cast<bool>(clear_refs << "5" << std::flush);
+}
+
+uint64_t peak_rss() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0)
+      return std::stoull(line.substr(6)) * 1024;
+  }
+
+  // ru_maxrss cannot be reset, but is available without procfs.
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0)
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+  return 0;
+}
+
+};
+
+namespace cold_start {
+
+static std::vector<std::pair<const char*, uint64_t>> recorded_phases;
+
+uint64_t process_start_time() {
+  // Field 22 of /proc/self/stat: start time in clock ticks after boot.
+  // The command name may contain spaces, so we parse after the closing parenthesis.
+  std::ifstream stat_file("/proc/self/stat");
+  std::string stat((std::istreambuf_iterator<char>(stat_file)), std::istreambuf_iterator<char>());
+  auto pos = stat.rfind(')');
+  if (pos == std::string::npos)
+    return 0;
+
+  std::istringstream fields(stat.substr(pos + 2));
+  std::string field;
+  uint64_t start_ticks = 0;
+  for (int idx = 3; idx <= 22 && fields >> field; ++idx) {
+    if (idx == 22)
+      start_ticks = std::stoull(field);
+  }
+
+  // Convert from ticks after boot to epoch using the current boot-time clock;
+  // /proc/stat's btime has only a resolution of one second.
+  struct timespec boot_now;
+  if (!start_ticks || clock_gettime(CLOCK_BOOTTIME, &boot_now) != 0)
+    return 0;
+  uint64_t now = timeSinceEpochMicrosec();
+  uint64_t since_boot = static_cast<uint64_t>(boot_now.tv_sec) * 1000000 + boot_now.tv_nsec / 1000;
+  uint64_t start_since_boot = start_ticks * 1000000 / sysconf(_SC_CLK_TCK);
+  return now - (since_boot - start_since_boot);
+}
+
+void record(const char* phase, uint64_t duration) {
+  recorded_phases.emplace_back(phase, duration);
+}
+
+const std::vector<std::pair<const char*, uint64_t>>& phases() {
+  return recorded_phases;
+}
+
+};
+
+namespace trace {
+
+static thread_local int32_t current_span = -1;
+
+Buffer& Buffer::get() {
+  static Buffer buffer;
+  return buffer;
+}
+
+void Buffer::reset() {
+  _size.store(0, std::memory_order_relaxed);
+  _dropped.store(0, std::memory_order_relaxed);
+  _origin = timeMonotonicNanosec();
+  current_span = -1;
+}
+
+int32_t Buffer::open(const char* name, int32_t parent) {
+  uint32_t idx = _size.fetch_add(1, std::memory_order_relaxed);
+  if (idx >= MAX_SPANS) {
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+    return -1;
+  }
+  _spans[idx] = Span{name, timeMonotonicNanosec(), 0, parent};
+  return static_cast<int32_t>(idx);
+}
+
+void Buffer::close(int32_t id) {
+  if (id >= 0)
+    _spans[id].end = timeMonotonicNanosec();
+}
+
+size_t Buffer::size() const {
+  uint32_t size = _size.load(std::memory_order_relaxed);
+  return size < MAX_SPANS ? size : MAX_SPANS;
+}
+
+int32_t current() { return current_span; }
+
+ScopedSpan::ScopedSpan(const char* name) : ScopedSpan(name, current_span) {}
+
+ScopedSpan::ScopedSpan(const char* name, int32_t parent) : _prev(current_span) {
+  _id = Buffer::get().open(name, parent);
+  if (_id >= 0)
+    current_span = _id;
+}
+
+ScopedSpan::~ScopedSpan() {
+  Buffer::get().close(_id);
+  current_span = _prev;
+}
+
+};
+};
@@ -2,8 +2,183 @@
 #ifndef UTILS_HPP
 #define UTILS_HPP
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
 #include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
 
 uint64_t timeSinceEpochMicrosec();
 
+// Monotonic timestamp (steady_clock) in nanoseconds; only meaningful as a difference.
+uint64_t timeMonotonicNanosec();
+
+namespace sebs {
+
+/**
+ * Runs f(idx) for every idx in [0, count) on at most `workers` threads,
+ * including the calling one. Items are claimed dynamically, so uneven
+ * work is balanced across threads.
+ */
+template<typename F>
+void parallel_for(size_t count, size_t workers, F && f)
+{
+  std::atomic<size_t> next{0};
+  auto worker = [&]() {
+    for (size_t idx = next.fetch_add(1); idx < count; idx = next.fetch_add(1))
+      f(idx);
+  };
+
+  std::vector<std::thread> threads;
+  size_t threads_count = std::min(std::max<size_t>(workers, 1), count);
+  for (size_t i = 1; i < threads_count; ++i)
+    threads.emplace_back(worker);
+  worker();
+  for (auto& thread : threads)
+    thread.join();
+}
+
+// Number of CPUs this process may use: the affinity mask, capped by the cgroup CPU quota.
+size_t available_cpus();
+
+/**
+ * Blocking FIFO with a fixed capacity, connecting stages of a pipeline.
+ * push() waits while the queue is full, which bounds the work in flight;
+ * pop() waits while it is empty and returns false once the queue has been
+ * closed and drained.
+ */
+template<typename T>
+class BoundedQueue {
+public:
+  explicit BoundedQueue(size_t capacity) : _capacity(std::max<size_t>(capacity, 1)) {}
+
+  void push(T value)
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _not_full.wait(lock, [this]() { return _items.size() < _capacity || _closed; });
+    _items.push_back(std::move(value));
+    _not_empty.notify_one();
+  }
+
+  bool pop(T& value)
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _not_empty.wait(lock, [this]() { return !_items.empty() || _closed; });
+    if (_items.empty())
+      return false;
+    value = std::move(_items.front());
+    _items.pop_front();
+    _not_full.notify_one();
+    return true;
+  }
+
+  void close()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _closed = true;
+    _not_empty.notify_all();
+    _not_full.notify_all();
+  }
+
+private:
+  std::deque<T> _items;
+  size_t _capacity;
+  bool _closed = false;
+  std::mutex _mutex;
+  std::condition_variable _not_empty;
+  std::condition_variable _not_full;
+};
+
+namespace memory {
+
+// Resets the peak resident set size (VmHWM) of the process; false if the kernel does not allow it.
+bool reset_peak_rss();
+
+// Peak resident set size in bytes since process start or the last successful reset.
+uint64_t peak_rss();
+
+};
+
+namespace cold_start {
+
+// Process start time in microseconds since epoch, from /proc/self/stat (clock tick resolution).
+uint64_t process_start_time();
+
+// Records a one-time initialization phase, e.g., first construction of a storage client.
+void record(const char* phase, uint64_t duration);
+
+const std::vector<std::pair<const char*, uint64_t>>& phases();
+
+};
+
+namespace trace {
+
+struct Span {
+  // Must point to a string with static storage duration, e.g., a literal.
+  const char* name;
+  uint64_t begin;
+  uint64_t end;
+  int32_t parent;
+};
+
+constexpr size_t MAX_SPANS = 512;
+
+/**
+ * Preallocated span storage for a single invocation.
+ * Reset by the handler before each invocation and serialized after it.
+ * Slots are claimed atomically, so spans can be opened from worker threads.
+ * Spans beyond capacity are dropped and counted.
+ */
+class Buffer {
+public:
+  static Buffer& get();
+
+  void reset();
+  int32_t open(const char* name, int32_t parent);
+  void close(int32_t id);
+
+  size_t size() const;
+  size_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+  uint64_t origin() const { return _origin; }
+  const Span& operator[](size_t idx) const { return _spans[idx]; }
+
+private:
+  std::array<Span, MAX_SPANS> _spans;
+  std::atomic<uint32_t> _size{0};
+  std::atomic<uint32_t> _dropped{0};
+  uint64_t _origin = 0;
+};
+
+// Innermost span open on the calling thread, -1 if none.
+int32_t current();
+
+/**
+ * RAII span. Nests under the innermost span of the calling thread, or under
+ * an explicit parent when work is handed over to another thread.
+ */
+class ScopedSpan {
+public:
+  explicit ScopedSpan(const char* name);
+  ScopedSpan(const char* name, int32_t parent);
+  ~ScopedSpan();
+
+  ScopedSpan(const ScopedSpan&) = delete;
+  ScopedSpan& operator=(const ScopedSpan&) = delete;
+
+  int32_t id() const { return _id; }
+
+private:
+  int32_t _id;
+  int32_t _prev;
+};
+
+};
+};
+
 #endif
@@ -0,0 +1,352 @@
+// Copyright 2020-2025 ETH Zurich and the SeBS authors. All rights reserved.
+/**
+ * Offline replay driver for C++ benchmarks.
+ *
+ * Links against the same `function(const rapidjson::Value&)` symbol as the
+ * Lambda handler, but does not need the Lambda runtime API. Requests are read
+ * from a JSONL file (one payload per line) and executed in-process.
+ *
+ * The CMakeLists.txt generated for every C++ benchmark has a `driver` target
+ * with the sources of the handler target, built on request: `make driver`.
+ *
+ * Set SEBS_STORAGE_DIR to serve objects from <dir>/<bucket>/<key> instead of S3,
+ * or MINIO_ADDRESS (with MINIO_ACCESS_KEY/MINIO_SECRET_KEY) for a MinIO instance.
+ *
+ * Usage:
+ *   driver <requests.jsonl> [--warm N] [--cold N] [--timeout S] [--output <file>]
+ *
+ *   --warm N     number of warm iterations over all payloads (default: 10)
+ *   --cold N     number of simulated cold starts per payload (default: 0)
+ *   --timeout S  function timeout in seconds, the deadline of retries (default: 60)
+ *
+ * Cold starts are simulated by forking a fresh child before the parent has
+ * executed any invocation; the child runs a single request and reports its
+ * latency back through a pipe. All function-local statics (clients, models)
+ * and the AWS SDK are therefore uninitialized in the child, as on a new
+ * sandbox. The parent then runs one pass over all payloads that is reported
+ * separately as "first.*", so that lazy initialization does not skew the
+ * warm percentiles. A benchmark's optional `initialize()` hook runs before
+ * the first request of each process and is reported as "cold.init"/"first.init".
+ *
+ * As in the handler, every request starts with empty trace and retry
+ * counters and a deadline of now + timeout.
+ *
+ * The report contains latency percentiles of the whole invocation and of
+ * every numeric field in the `measurement`/`measurements` object returned
+ * by the benchmark, in microseconds.
+ */
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifdef SEBS_USE_AWS_SDK
+#include <aws/core/Aws.h>
+#endif
+
+#include <rapidjson/document.h>
+#include <rapidjson/prettywriter.h>
+#include <rapidjson/stringbuffer.h>
+
+#include "retry.hpp"
+#include "utils.hpp"
+
+rapidjson::Document function(const rapidjson::Value& req);
+void initialize() __attribute__((weak));
+
+namespace {
+
+using Samples = std::map<std::string, std::vector<double>>;
+
+struct Options {
+  std::string input;
+  std::string output;
+  int warm_iterations = 10;
+  int cold_starts = 0;
+  int timeout = 60;
+};
+
+void usage(const char* name)
+{
+  std::cerr << "Usage: " << name
+            << " <requests.jsonl> [--warm N] [--cold N] [--timeout S] [--output <file>]\n";
+}
+
+bool parse_options(int argc, char** argv, Options& opts)
+{
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--warm" && i + 1 < argc) {
+      opts.warm_iterations = std::atoi(argv[++i]);
+    } else if (arg == "--cold" && i + 1 < argc) {
+      opts.cold_starts = std::atoi(argv[++i]);
+    } else if (arg == "--timeout" && i + 1 < argc) {
+      opts.timeout = std::atoi(argv[++i]);
+    } else if (arg == "--output" && i + 1 < argc) {
+      opts.output = argv[++i];
+    } else if (!arg.empty() && arg[0] != '-' && opts.input.empty()) {
+      opts.input = arg;
+    } else {
+      return false;
+    }
+  }
+  return !opts.input.empty() && opts.warm_iterations >= 0 && opts.cold_starts >= 0 &&
+    opts.timeout > 0;
+}
+
+// Mirrors handler.cpp: API Gateway payloads carry the request serialized under 'body'.
+bool load_requests(const std::string& path, std::vector<rapidjson::Document>& requests)
+{
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    std::cerr << "Failed to open requests file: " << path << std::endl;
+    return false;
+  }
+
+  std::string line;
+  size_t line_no = 0;
+  while (std::getline(file, line)) {
+    ++line_no;
+    if (line.find_first_not_of(" \t\r") == std::string::npos)
+      continue;
+
+    rapidjson::Document doc;
+    doc.Parse(line.c_str());
+    if (!doc.HasParseError() && doc.IsObject() && doc.HasMember("body") && doc["body"].IsString()) {
+      rapidjson::Document body_doc;
+      body_doc.Parse(doc["body"].GetString());
+      doc = std::move(body_doc);
+    }
+    if (doc.HasParseError() || !doc.IsObject()) {
+      std::cerr << "Invalid JSON payload at line " << line_no << std::endl;
+      return false;
+    }
+    requests.push_back(std::move(doc));
+  }
+  return !requests.empty();
+}
+
+// Executes one request; records total latency and the benchmark's own measurements.
+bool invoke(const rapidjson::Value& request, const std::string& prefix, int timeout, Samples& samples)
+{
+  sebs::trace::Buffer::get().reset();
+  sebs::retry::reset();
+  sebs::retry::set_deadline(timeSinceEpochMicrosec() + static_cast<uint64_t>(timeout) * 1000000);
+  const auto begin = std::chrono::steady_clock::now();
+  auto ret = function(request);
+  const auto end = std::chrono::steady_clock::now();
+
+  samples[prefix + "latency"].push_back(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() / 1000.0
+  );
+
+  if (ret.IsObject() && ret.HasMember("error")) {
+    if (ret["error"].IsString())
+      std::cerr << "Function error: " << ret["error"].GetString() << std::endl;
+    return false;
+  }
+
+  for (const char* field : {"measurement", "measurements"}) {
+    if (!ret.IsObject() || !ret.HasMember(field) || !ret[field].IsObject())
+      continue;
+    for (auto& m : ret[field].GetObject()) {
+      if (m.value.IsNumber())
+        samples[prefix + m.name.GetString()].push_back(m.value.GetDouble());
+    }
+  }
+  return true;
+}
+
+// Runs the benchmark's init hook, if any, as the handler does before the first request.
+void run_initialize(const std::string& prefix, Samples& samples)
+{
+  if (!initialize)
+    return;
+  const auto begin = std::chrono::steady_clock::now();
+  initialize();
+  const auto end = std::chrono::steady_clock::now();
+  samples[prefix + "init"].push_back(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() / 1000.0
+  );
+}
+
+// Runs a single request in a forked child so that all function statics are fresh.
+bool invoke_cold(const rapidjson::Value& request, int timeout, Samples& samples)
+{
+  int fds[2];
+  if (pipe(fds) != 0) {
+    std::cerr << "pipe failed: " << std::strerror(errno) << std::endl;
+    return false;
+  }
+
+  pid_t pid = fork();
+  if (pid < 0) {
+    std::cerr << "fork failed: " << std::strerror(errno) << std::endl;
+    close(fds[0]);
+    close(fds[1]);
+    return false;
+  }
+
+  if (pid == 0) {
+    close(fds[0]);
+#ifdef SEBS_USE_AWS_SDK
+    Aws::SDKOptions sdk_options;
+    Aws::InitAPI(sdk_options);
+#endif
+    Samples child;
+    run_initialize("cold.", child);
+    bool ok = invoke(request, "cold.", timeout, child);
+
+    // Serialize as "name value\n" lines; names never contain whitespace.
+    std::string out;
+    for (auto& kv : child)
+      for (double v : kv.second)
+        out += kv.first + " " + std::to_string(v) + "\n";
+    size_t written = 0;
+    while (written < out.size()) {
+      ssize_t n = write(fds[1], out.data() + written, out.size() - written);
+      if (n <= 0)
+        break;
+      written += n;
+    }
+    close(fds[1]);
+    _exit(ok ? 0 : 1);
+  }
+
+  close(fds[1]);
+  std::string data;
+  char buf[4096];
+  ssize_t n;
+  while ((n = read(fds[0], buf, sizeof(buf))) > 0)
+    data.append(buf, n);
+  close(fds[0]);
+
+  int status = 0;
+  waitpid(pid, &status, 0);
+
+  size_t pos = 0;
+  while (pos < data.size()) {
+    size_t eol = data.find('\n', pos);
+    std::string line = data.substr(pos, eol - pos);
+    size_t sep = line.find(' ');
+    if (sep != std::string::npos)
+      samples[line.substr(0, sep)].push_back(std::atof(line.c_str() + sep + 1));
+    if (eol == std::string::npos)
+      break;
+    pos = eol + 1;
+  }
+
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// Nearest-rank percentile on a sorted sample.
+double percentile(const std::vector<double>& sorted, double p)
+{
+  if (sorted.empty())
+    return 0.0;
+  size_t rank = static_cast<size_t>(p / 100.0 * (sorted.size() - 1) + 0.5);
+  return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+rapidjson::Document summarize(Samples& samples, const Options& opts, size_t requests, int failures)
+{
+  rapidjson::Document report;
+  report.SetObject();
+  auto& alloc = report.GetAllocator();
+
+  report.AddMember("requests", (uint64_t)requests, alloc);
+  report.AddMember("warm_iterations", opts.warm_iterations, alloc);
+  report.AddMember("cold_starts", opts.cold_starts, alloc);
+  report.AddMember("failures", failures, alloc);
+
+  rapidjson::Value phases(rapidjson::kObjectType);
+  for (auto& kv : samples) {
+    auto& v = kv.second;
+    std::sort(v.begin(), v.end());
+    double sum = 0.0;
+    for (double x : v)
+      sum += x;
+
+    rapidjson::Value stats(rapidjson::kObjectType);
+    stats.AddMember("count", (uint64_t)v.size(), alloc);
+    stats.AddMember("mean", v.empty() ? 0.0 : sum / v.size(), alloc);
+    stats.AddMember("min", v.empty() ? 0.0 : v.front(), alloc);
+    stats.AddMember("p50", percentile(v, 50), alloc);
+    stats.AddMember("p90", percentile(v, 90), alloc);
+    stats.AddMember("p99", percentile(v, 99), alloc);
+    stats.AddMember("max", v.empty() ? 0.0 : v.back(), alloc);
+    phases.AddMember(rapidjson::Value(kv.first.c_str(), alloc), stats, alloc);
+  }
+  report.AddMember("phases", phases, alloc);
+  return report;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  Options opts;
+  if (!parse_options(argc, argv, opts)) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  std::vector<rapidjson::Document> requests;
+  if (!load_requests(opts.input, requests)) {
+    std::cerr << "No valid requests in " << opts.input << std::endl;
+    return 1;
+  }
+
+  Samples samples;
+  int failures = 0;
+
+  // Cold runs must happen before the parent process initializes anything.
+  std::cout.flush();
+  for (int i = 0; i < opts.cold_starts; ++i)
+    for (auto& req : requests)
+      if (!invoke_cold(req, opts.timeout, samples))
+        ++failures;
+
+#ifdef SEBS_USE_AWS_SDK
+  Aws::SDKOptions sdk_options;
+  Aws::InitAPI(sdk_options);
+#endif
+  run_initialize("first.", samples);
+
+  for (auto& req : requests)
+    if (!invoke(req, "first.", opts.timeout, samples))
+      ++failures;
+
+  for (int i = 0; i < opts.warm_iterations; ++i)
+    for (auto& req : requests)
+      if (!invoke(req, "warm.", opts.timeout, samples))
+        ++failures;
+
+  rapidjson::Document report = summarize(samples, opts, requests.size(), failures);
+
+  rapidjson::StringBuffer buffer;
+  rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+  report.Accept(writer);
+
+  if (opts.output.empty()) {
+    std::cout << buffer.GetString() << std::endl;
+  } else {
+    std::ofstream out(opts.output);
+    out << buffer.GetString() << std::endl;
+  }
+
+#ifdef SEBS_USE_AWS_SDK
+  Aws::ShutdownAPI(sdk_options);
+#endif
+  return failures == 0 ? 0 : 2;
+}
@@ -557,6 +557,12 @@ class AWS(System):
                 code_package.benchmark
             ).items():
                 envs[f"NOSQL_STORAGE_TABLE_{original_name}"] = actual_name
+        if code_package.uses_storage and code_package.language == Language.CPP:
+            # The C++ handler opens connections to this bucket during init.
+            envs["SEBS_STORAGE_BUCKET"] = self.system_resources.get_storage().get_bucket(
+                Resources.StorageBucketType.BENCHMARKS
+            )
+            envs.update(code_package.function_environment)
 
         # AWS Lambda will overwrite existing variables
         # If we modify them, we need to first read existing ones and append.
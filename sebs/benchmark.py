@@ -236,14 +236,20 @@ class BenchmarkConfig:
         Returns:
             BenchmarkConfig: A new instance with the deserialized data
         """
+        modules = [BenchmarkModule(x) for x in json_object["modules"]]
+        cpp_dependencies = [
+            CppDependencies.deserialize(x) for x in json_object.get("cpp_dependencies", [])
+        ]
+        # The Redis wrapper is built on hiredis.
+        if BenchmarkModule.REDIS in modules and CppDependencies.HIREDIS not in cpp_dependencies:
+            cpp_dependencies.append(CppDependencies.HIREDIS)
+
         return BenchmarkConfig(
             json_object["timeout"],
             json_object["memory"],
             [LanguageSpec.deserialize(x) for x in json_object["languages"]],
-            [BenchmarkModule(x) for x in json_object["modules"]],
-            cpp_dependencies=[
-                CppDependencies.deserialize(x) for x in json_object.get("cpp_dependencies", [])
-            ],
+            modules,
+            cpp_dependencies=cpp_dependencies,
         )
 
 
@@ -511,6 +517,17 @@ class Benchmark(LoggingBase):
         """
         return self._uses_nosql
 
+    @property
+    def function_environment(self) -> Dict[str, str]:
+        """
+        Get environment variables the benchmark requests for its function.
+
+        Returns:
+            Dict[str, str]: Variables returned by the input module's optional
+                `function_environment` hook; empty if it is not defined.
+        """
+        return self._function_environment
+
     @property
     def architecture(self) -> str:
         """
@@ -660,6 +677,7 @@ class Benchmark(LoggingBase):
         self._input_processed: bool = False
         self._uses_storage: bool = False
         self._uses_nosql: bool = False
+        self._function_environment: Dict[str, str] = {}
 
     @staticmethod
     def hash_directory(
@@ -730,6 +748,11 @@ class Benchmark(LoggingBase):
                 else:
                     with open(f, "rb") as opened_file:
                         hash_sum.update(opened_file.read())
+        # The replay driver is built from every C++ package.
+        if language == Language.CPP:
+            driver = get_resource_path("benchmarks", "wrappers", "local", "cpp", "driver.cpp")
+            with open(driver, "rb") as opened_file:
+                hash_sum.update(opened_file.read())
         return hash_sum.hexdigest()
 
     def serialize(self) -> dict:
@@ -1041,20 +1064,36 @@ class Benchmark(LoggingBase):
         The CMake file contains multiple steps:
         * Basic definition of benchmark target.
         * Packaging instructions for AWS.
-        * Linking dependencies required by the benchmark.
-        * Linking AWS SDK and Hiredis.
+        * Linking dependencies required by the benchmark; the Redis module adds hiredis,
+          and igraph adds the shared graph generator.
+        * Linking AWS SDK.
+        * The offline replay driver (wrappers/local/cpp/driver.cpp): the same sources
+          with driver.cpp in place of handler.cpp and without the Lambda runtime,
+          built only on request with `make driver`.
 
         Args:
             output_dir: Benchmark directory
         """
 
-        files = ["handler.cpp", "utils.cpp", "main.cpp"]
+        files = ["handler.cpp", "utils.cpp", "perf-counters.cpp", "retry.cpp", "main.cpp"]
+        definitions = []
         if BenchmarkModule.STORAGE in self.benchmark_config.modules:
-            files.append("storage.cpp")
+            files.extend(["storage.cpp", "s3-storage.cpp", "local-storage.cpp"])
+            # handler.cpp creates the storage client during init
+            definitions.append("SEBS_WITH_STORAGE")
         if BenchmarkModule.NOSQL in self.benchmark_config.modules:
             files.append("key-value.cpp")
-        # TODO: add module for redis
+        if BenchmarkModule.REDIS in self.benchmark_config.modules:
+            files.append("redis.cpp")
+        # Graph generation shared by the igraph benchmarks
+        if CppDependencies.IGRAPH in self._benchmark_config._cpp_dependencies:
+            files.append("graph.cpp")
         files_str = " ".join(files)
+        definitions_line = (
+            f"target_compile_definitions(${{PROJECT_NAME}} PRIVATE {' '.join(definitions)})"
+            if definitions
+            else ""
+        )
 
         cmake_script = f"""
         cmake_minimum_required(VERSION 3.9)
@@ -1069,32 +1108,41 @@ class Benchmark(LoggingBase):
 
         target_compile_features(${{PROJECT_NAME}} PRIVATE "cxx_std_14")
         target_compile_options(${{PROJECT_NAME}} PRIVATE "-Wall" "-Wextra")
+        {definitions_line}
 
         find_package(aws-lambda-runtime)
         target_link_libraries(${{PROJECT_NAME}} PRIVATE AWS::aws-lambda-runtime)
+
+        find_package(Threads REQUIRED)
+        target_link_libraries(${{PROJECT_NAME}} PRIVATE Threads::Threads)
         """
 
         for dependency in self._benchmark_config._cpp_dependencies:
             cmake_script += CppDependencies.to_cmake_list(dependency)
 
-        """
-            FIXME: we disabled Hiredis as this is currently not used.
-            We need a proper module for that.
-        """
-
         cmake_script += """
 
-        # find_package(PkgConfig REQUIRED)
-        # set(ENV{PKG_CONFIG_PATH} "/opt/lib/pkgconfig")
-        # pkg_check_modules(HIREDIS REQUIRED IMPORTED_TARGET hiredis)
-
-        # target_include_directories(${PROJECT_NAME} PUBLIC PkgConfig::HIREDIS)
-        # target_link_libraries(${PROJECT_NAME} PUBLIC PkgConfig::HIREDIS)
-
         # this line creates a target that packages your binary and zips it up
         aws_lambda_package_target(${PROJECT_NAME})
         """
 
+        driver_files_str = " ".join(["driver.cpp"] + files[1:])
+        cmake_script += f"""
+        add_executable(driver EXCLUDE_FROM_ALL {driver_files_str})
+        target_include_directories(driver PRIVATE ".")
+        target_compile_options(driver PRIVATE "-Wall" "-Wextra")
+        {definitions_line.replace("${PROJECT_NAME}", "driver")}
+        target_link_libraries(driver PRIVATE Threads::Threads)
+        """
+        for dependency in self._benchmark_config._cpp_dependencies:
+            if dependency != CppDependencies.RUNTIME:
+                cmake_script += CppDependencies.to_cmake_list(dependency).replace(
+                    "${PROJECT_NAME}", "driver"
+                )
+        shutil.copy2(
+            get_resource_path("benchmarks", "wrappers", "local", "cpp", "driver.cpp"), output_dir
+        )
+
         self.logging.info(
             f"CPP benchmark {self.benchmark} has "
             + str(len(self._benchmark_config._cpp_dependencies))
@@ -1674,6 +1722,12 @@ class Benchmark(LoggingBase):
         if hasattr(self._benchmark_input_module, "allocate_nosql"):
             nosql_storage.update_cache(self._benchmark)
 
+        # Optional: environment of the function that depends on allocated storage.
+        if hasattr(self._benchmark_input_module, "function_environment"):
+            self._function_environment = self._benchmark_input_module.function_environment(
+                input, output
+            )
+
         self._input_processed = True
 
         return input_config
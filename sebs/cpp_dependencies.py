@@ -46,7 +46,7 @@ class CppDependencies(str, Enum):
         RUNTIME: AWS C++ Lambda Runtime
         TORCH: Torch C++ API
         OPENCV: OpenCV
-        LIBJPEG_TURBO: Libjpeg-turbo (used in 210.thumbnailer)
+        LIBJPEG_TURBO: Libjpeg-turbo (used in 210.thumbnailer and 411.image-recognition)
         IGRAPH: Graph library used in 50* benchmarks
         BOOST: Standard Boost libraries
         HIREDIS: Redis client library used by storage wrappers
@@ -103,7 +103,8 @@ class CppDependencies(str, Enum):
             CppDependencies.LIBJPEG_TURBO: CppDependencyConfig(
                 docker_img="dependencies-libjpeg-turbo.aws.cpp.all",
                 cmake_package=None,
-                cmake_libs="/opt/libjpeg-turbo/lib64/libturbojpeg.a",
+                # libjpeg API is used for strip-wise decoding of large images.
+                cmake_libs="/opt/libjpeg-turbo/lib64/libturbojpeg.a /opt/libjpeg-turbo/lib64/libjpeg.a",
                 cmake_dir="/opt/libjpeg-turbo/include",
                 runtime_paths=["/opt/libjpeg-turbo"],
             ),
@@ -17,10 +17,13 @@ class BenchmarkModule(str, Enum):
     are needed for the benchmark to work correctly.
 
     - STORAGE: Object storage module for storing and retrieving files
+    - NOSQL: NoSQL database module for key-value access
+    - REDIS: Redis client for low-latency data exchange (C++ only)
     """
 
     STORAGE = "storage"
     NOSQL = "nosql"
+    REDIS = "redis"
 
 
 class Platforms(str, Enum):